@@ -4,7 +4,7 @@ var daq_progress;
 function daq_init() {
 
 	LiteAjax('/json/status', function(d) {
-		if (d['daq-samples'] > 0) {
+		if (d['daq-tasks'] >= d['daq-tasks-max']) {
 			daq_progress();
 			return;
 		}
@@ -22,8 +22,15 @@ function daq_start() {
 
 	$('submit').disabled = true;
 
+	// zaznaczone kanay
+	var ch = [];
+
+	for (i=0; i<$('ch').options.length; i++)
+		if ($('ch').options[i].selected)
+			ch.push($('ch').options[i].value.split('-')[1]);
+
 	query = '/json/daq/start/' + $('name').value.replace(/[^a-z0-9]/gi, '').toLowerCase() + 
-					'/' + $('ch').options[$('ch').selectedIndex].value.split('-')[1] +
+					'/' + ch.join(',') +
 					'/' + parseInt($('delay').value) +
 					'/' + parseInt($('samples').value);
 	
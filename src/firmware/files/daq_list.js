@@ -8,8 +8,8 @@ LiteAjax('/json/daq/list', function(data) {
 		url = '/daq/get/' + file[0];
 		
 		tr.innerHTML = '<td><a href="'+url+'">'+file[0]+'</a></td>' +
-			// '<td>'+(new Date(file[1])).toLocaleString()+'</td>' +
-			'<td>'+(file[2]>>1)+'</td>' +
+			'<td>'+(file[3] > 0 ? (new Date(file[3]*1000)).toUTCString().replace(' GMT', '') : '-')+'</td>' +
+			'<td>'+file[2]+'</td>' +
 			'<td><a style="cursor:pointer" onclick="daq_delete(\''+file[0]+'\', this.parentNode.parentNode)">Skasuj</a></td>';
 	}
 });
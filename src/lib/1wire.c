@@ -1,5 +1,22 @@
 #include "1wire.h"
 
+// piny kolejnych magistral
+const unsigned char ow_bus_pins[OW_BUSES] PROGMEM = OW_BUS_PINS;
+
+void ow_init()
+{
+    unsigned char b;
+
+    for (b = 0; b < OW_BUSES; b++) {
+        ow_bus_mask[b] = 1 << pgm_read_byte(&ow_bus_pins[b]);
+
+        // linie bez podcigania (rezystory zewntrzne)
+        OW_PORT &= ~ow_bus_mask[b];
+        DDR(OW_PORT) &= ~ow_bus_mask[b];
+    }
+
+    ow_select_bus(0);
+}
 
 // reset magistrali 1wire (zwraca informacje czy na magistrali dziala slave)
 unsigned char ow_reset()
@@ -134,6 +151,270 @@ void ow_write(unsigned char value)
 
 
 
+// -----------------------------------------------------------------------------------------
+// transakcje w tle
+
+unsigned char ow_start(unsigned char buses, unsigned char tx_len, unsigned char rx_len, void (*done)(unsigned char))
+{
+    unsigned char b;
+
+    if ( ow_busy() || (tx_len > OW_TX_MAX) || (rx_len > OW_RX_MAX) ) {
+        return 0;
+    }
+
+    ow_buses  = buses;
+    ow_active = 0;
+
+    for (b = 0; b < OW_BUSES; b++) {
+        if (buses & (1 << b)) {
+            ow_active |= ow_bus_mask[b];
+            memset((void*)ow_rx[b], 0, rx_len);
+        }
+    }
+
+    ow_tx_len = tx_len;
+    ow_len    = tx_len + rx_len;
+    ow_poll   = 0;
+    ow_pos    = 0;
+    ow_bit    = 0;
+    ow_done   = done;
+    ow_state  = OW_STATE_RESET;
+
+    ow_schedule(OW_RECOVERY_US);
+
+    return 1;
+}
+
+unsigned char ow_start_poll(unsigned char buses, unsigned char tx_len, void (*done)(unsigned char))
+{
+    if ( !ow_start(buses, tx_len, 0, done) ) {
+        return 0;
+    }
+
+    ow_poll       = 1;
+    ow_ready      = 0;
+    ow_poll_count = 0;
+
+    return 1;
+}
+
+unsigned char ow_start_search(unsigned char bus, unsigned char cmd, void (*done)(unsigned char))
+{
+    ow_tx[bus][0] = cmd;
+
+    if ( !ow_start(1 << bus, 1, 0, done) ) {
+        return 0;
+    }
+
+    ow_search_cmd = cmd;
+    ow_search_begin();
+
+    ow_poll = 2;    // po poleceniu - wyszukiwanie
+
+    return 1;
+}
+
+unsigned char ow_read_slot()
+{
+    OW_PORT &= ~ow_active;
+    DDR(OW_PORT) |= ow_active;
+
+    _delay_us(OW_DELAY_A);
+    DDR(OW_PORT) &= ~ow_active;
+    _delay_us(OW_DELAY_E);
+
+    return PIN(OW_PORT);
+}
+
+void ow_schedule(unsigned int us)
+{
+    unsigned int at = TCNT1 + OW_TICKS(us);
+
+    // licznik Timera1 liczy od 0 do OCR1A
+    if (at > OCR1A) {
+        at -= OCR1A + 1;
+    }
+
+    OCR1B = at;
+
+    TIFR  = (1 << OCF1B);
+    TIMSK |= (1 << OCIE1B);
+}
+
+void ow_on_timer()
+{
+    unsigned char b, ones, pins;
+
+    switch (ow_state) {
+
+        // impulsu resetu (co najmniej 480 us) nie trzeba koczy dokadnie
+        case OW_STATE_RESET:
+            OW_PORT &= ~ow_active;
+            DDR(OW_PORT) |= ow_active;
+
+            ow_state = OW_STATE_PRESENCE;
+            ow_schedule(480);
+            return;
+
+        // zwolnij linie, po 70 us sprawd zgoszenia slave'w (czas krytyczny - w przerwaniu)
+        case OW_STATE_PRESENCE:
+            DDR(OW_PORT) &= ~ow_active;
+            _delay_loop_2(OW_DELAY_I);
+
+            pins = PIN(OW_PORT);
+
+            // magistrale bez zgoszenia wypadaj z transakcji
+            for (b = 0; b < OW_BUSES; b++) {
+                if (pins & ow_bus_mask[b]) {
+                    ow_active &= ~ow_bus_mask[b];
+                    ow_buses  &= ~(1 << b);
+                }
+            }
+
+            if (!ow_active) {
+                break;
+            }
+
+            // reszta okna zgoszenia
+            ow_state = OW_STATE_BITS;
+            ow_schedule(410);
+            return;
+
+        // slave ciga lini w szczelinach odczytu do zakoczenia operacji
+        case OW_STATE_POLL:
+            pins = ow_read_slot();
+
+            for (b = 0; b < OW_BUSES; b++) {
+                if ( (ow_buses & (1 << b)) && (pins & ow_bus_mask[b]) ) {
+                    ow_ready  |= 1 << b;
+                    ow_active &= ~ow_bus_mask[b];
+                }
+            }
+
+            if ( !ow_active || (++ow_poll_count == OW_POLL_MAX) ) {
+                ow_buses = ow_ready;
+                break;
+            }
+
+            ow_schedule(OW_POLL_US);
+            return;
+
+        // wyszukiwanie: szczeliny odczytu bitu i dopenienia, zapis kierunku (ow_bit - numer szczeliny)
+        case OW_STATE_SEARCH:
+            // koniec ostatniej szczeliny
+            if (ow_bit == 3) {
+                break;
+            }
+
+            if (ow_bit < 2) {
+                pins = ow_read_slot();
+
+                ow_rx[0][ow_bit++] = (pins & ow_active) ? 1 : 0;
+                ow_schedule(55);
+                return;
+            }
+
+            ones = ow_search_step(ow_rx[0][0], ow_rx[0][1]);
+
+            if (ones > 1) {
+                ow_buses = 0;
+                break;
+            }
+
+            OW_PORT &= ~ow_active;
+            DDR(OW_PORT) |= ow_active;
+
+            if (ones) {
+                _delay_us(OW_DELAY_A);
+                DDR(OW_PORT) &= ~ow_active;
+                ow_schedule(64);
+            }
+            else {
+                _delay_loop_2(OW_DELAY_C);
+                DDR(OW_PORT) &= ~ow_active;
+                ow_schedule(OW_RECOVERY_US);
+            }
+
+            // wszystkie bity kodu ROM - po tej szczelinie wynik dla ow_done
+            ow_bit = (ow_search_byte == 8) ? 3 : 0;
+            return;
+
+        case OW_STATE_BITS:
+            if (ow_pos == ow_len) {
+                // zapis zakoczony - odpytuj zakoczenie operacji / wyszukuj
+                if (ow_poll) {
+                    ow_state = (ow_poll == 1) ? OW_STATE_POLL : OW_STATE_SEARCH;
+                    ow_bit   = 0;
+                    ow_schedule(OW_RECOVERY_US);
+                    return;
+                }
+
+                break;
+            }
+
+            // zapis: magistrale, na ktre idzie "1" zwalniane po 6 us, pozostae po 60 us
+            if (ow_pos < ow_tx_len) {
+                ones = 0;
+
+                for (b = 0; b < OW_BUSES; b++) {
+                    if ( (ow_buses & (1 << b)) && ((ow_tx[b][ow_pos] >> ow_bit) & 1) ) {
+                        ones |= ow_bus_mask[b];
+                    }
+                }
+
+                OW_PORT &= ~ow_active;
+                DDR(OW_PORT) |= ow_active;
+
+                _delay_us(OW_DELAY_A);
+                DDR(OW_PORT) &= ~ones;
+
+                if (ones != ow_active) {
+                    _delay_loop_2(OW_DELAY_C);
+                    DDR(OW_PORT) &= ~ow_active;
+                    ow_schedule(OW_RECOVERY_US);
+                }
+                else {
+                    ow_schedule(64);
+                }
+            }
+            // odczyt: jedna prbka portu dla wszystkich magistral
+            else {
+                pins = ow_read_slot();
+
+                ow_schedule(55);
+
+                for (b = 0; b < OW_BUSES; b++) {
+                    if (pins & ow_bus_mask[b]) {
+                        ow_rx[b][ow_pos - ow_tx_len] |= 1 << ow_bit;
+                    }
+                }
+            }
+
+            if (++ow_bit == 8) {
+                ow_bit = 0;
+                ow_pos++;
+            }
+            return;
+    }
+
+    // koniec transakcji
+    TIMSK &= ~(1 << OCIE1B);
+    DDR(OW_PORT) &= ~ow_active;
+
+    ow_state = OW_STATE_IDLE;
+
+    // koniec przebiegu wyszukiwania (rwnie przerwanego) - kod ROM w OW_ROM
+    if ( (ow_poll == 2) && !ow_search_end() ) {
+        ow_buses = 0;
+    }
+
+    if (ow_done) {
+        ow_done(ow_buses);
+    }
+}
+
+// -----------------------------------------------------------------------------------------
+
 // odczytaj kod ROM (tylko dla jednego slave'a!)
 void ow_read_rom_code(unsigned char* code)
 {
@@ -170,9 +451,9 @@ void ow_match_rom(unsigned char* code)
 // znajdz pierwsze urzadzenie 1wire 
 unsigned char ow_first_search()
 {   
-	LastDiscrepancy = 0;
-	LastDeviceFlag  = 0;			// reset the search state
-	LastFamilyDiscrepancy = 0;
+    ow_search_cmd = OW_SEARCH_ROM;
+
+    ow_search_reset();
 
 	return ow_search();
 }
@@ -187,18 +468,10 @@ unsigned char ow_next_search()
 // znajdz urzadzenia 1wire
 unsigned char ow_search()
 {
-   	unsigned char id_bit_number;
-   	unsigned char last_zero, rom_byte_number, search_result;
-   	unsigned char id_bit, cmp_id_bit;
-   	unsigned char rom_byte_mask, search_direction;
-
-   	// initialize for search
-   	id_bit_number = 1;
-	last_zero = 0;
-   	rom_byte_number = 0;
-   	rom_byte_mask = 1;
-   	search_result = 0;
-   	crc8 = 0;
+    unsigned char id_bit, cmp_id_bit, search_direction;
+
+    // initialize for search
+    ow_search_begin();
 
    	// if the last call was not the last one
    	if (!LastDeviceFlag)
@@ -212,7 +485,7 @@ unsigned char ow_search()
       	}
 
 
-      	ow_write(0xF0);  // issue the search command 
+      	ow_write(ow_search_cmd);  // issue the search command (0xF0 - wszystkie / 0xEC - tylko z alarmem)
 
       
       	do				// loop to do the search
@@ -220,88 +493,120 @@ unsigned char ow_search()
          	id_bit = ow_read_bit();		// read a bit and its complement
          	cmp_id_bit = ow_read_bit();
 
+            search_direction = ow_search_step(id_bit, cmp_id_bit);
+
          	// check for no devices on 1-wire
-         	if ((id_bit == 1) && (cmp_id_bit == 1))
-    		{
-            	break;
-    		}
-         	else
-         	{
-            	// all devices coupled have 0 or 1
-            	if (id_bit != cmp_id_bit)
-    			{
-               		search_direction = id_bit;  // bit write value for search
-    			}
-            	else
-           		{
-               		// if this discrepancy if before the Last Discrepancy
-               		// on a previous next then pick the same as last time
-               		if (id_bit_number < LastDiscrepancy)
-    				{
-                  		search_direction = ((OW_ROM[rom_byte_number] & rom_byte_mask) > 0);
-    				}
-               		else
-    				{
-                  		// if equal to last pick 1, if not then pick 0
-                  		search_direction = (id_bit_number == LastDiscrepancy);
-    				}
-               		// if 0 was picked then record its position in LastZero
-               		if (search_direction == 0)
-               		{
-                  		last_zero = id_bit_number;
-
-                  		// check for Last discrepancy in family
-                  		if (last_zero < 9)
-    					{
-                     		LastFamilyDiscrepancy = last_zero;
-    					}
-               		}
-            	}
-
-        		// set or clear the bit in the ROM byte rom_byte_number
-        		// with mask rom_byte_mask
-        		if (search_direction == 1)
-    			{
-          			OW_ROM[rom_byte_number] |= rom_byte_mask;
-    			}
-        		else
-    			{
-          			OW_ROM[rom_byte_number] &= ~rom_byte_mask;
-    			}
-
-                // serial number search direction write bit
-                ow_write_bit(search_direction);
-
-                // increment the byte counter id_bit_number
-                // and shift the mask rom_byte_mask
-                id_bit_number++;
-                rom_byte_mask <<= 1;
-
-                // if the mask is 0 then go to new SerialNum byte rom_byte_number and reset mask
-                if (rom_byte_mask == 0)
-                {
-                    //docrc8(ROM_NO[rom_byte_number]);  // accumulate the CRC
-                    rom_byte_number++;
-                    rom_byte_mask = 1;
-                }
-     		}
+            if (search_direction > 1)
+            {
+                break;
+            }
+
+            // serial number search direction write bit
+            ow_write_bit(search_direction);
       	}
-  		while(rom_byte_number < 8);  // loop until through all ROM bytes 0-7
-      			
-        // if the search was successful then
-		if (!((id_bit_number < 65) ))//|| (crc8 != 0)))
-		{
- 			// search successful so set LastDiscrepancy,LastDeviceFlag,search_result
- 			LastDiscrepancy = last_zero;
-
- 			// check for last device
- 			if (LastDiscrepancy == 0)
-			{
-    		    LastDeviceFlag = 1;
-			}
-            search_result = 1;
-		}
-	}
+  		while(ow_search_byte < 8);  // loop until through all ROM bytes 0-7
+    }
+
+    return ow_search_end();
+}
+
+// przygotuj kolejny przebieg wyszukiwania
+void ow_search_begin()
+{
+   	ow_search_bit = 1;
+	ow_search_last_zero = 0;
+   	ow_search_byte = 0;
+   	ow_search_mask = 1;
+   	crc8 = 0;
+}
+
+// kolejny bit kodu ROM: bit i jego dopenienie odczytane z magistrali -> kierunek (bit do zapisu), 2 - brak urzdze
+unsigned char ow_search_step(unsigned char id_bit, unsigned char cmp_id_bit)
+{
+    unsigned char search_direction;
+
+    // check for no devices on 1-wire
+    if ((id_bit == 1) && (cmp_id_bit == 1))
+    {
+        return 2;
+    }
+
+    // all devices coupled have 0 or 1
+    if (id_bit != cmp_id_bit)
+    {
+        search_direction = id_bit;  // bit write value for search
+    }
+    else
+    {
+        // if this discrepancy if before the Last Discrepancy
+        // on a previous next then pick the same as last time
+        if (ow_search_bit < LastDiscrepancy)
+        {
+            search_direction = ((OW_ROM[ow_search_byte] & ow_search_mask) > 0);
+        }
+        else
+        {
+            // if equal to last pick 1, if not then pick 0
+            search_direction = (ow_search_bit == LastDiscrepancy);
+        }
+        // if 0 was picked then record its position in LastZero
+        if (search_direction == 0)
+        {
+            ow_search_last_zero = ow_search_bit;
+
+            // check for Last discrepancy in family
+            if (ow_search_last_zero < 9)
+            {
+                LastFamilyDiscrepancy = ow_search_last_zero;
+            }
+        }
+    }
+
+    // set or clear the bit in the ROM byte rom_byte_number
+    // with mask rom_byte_mask
+    if (search_direction == 1)
+    {
+        OW_ROM[ow_search_byte] |= ow_search_mask;
+    }
+    else
+    {
+        OW_ROM[ow_search_byte] &= ~ow_search_mask;
+    }
+
+    // increment the byte counter id_bit_number
+    // and shift the mask rom_byte_mask
+    ow_search_bit++;
+    ow_search_mask <<= 1;
+
+    // if the mask is 0 then go to new SerialNum byte rom_byte_number and reset mask
+    if (ow_search_mask == 0)
+    {
+        crc8 = _crc_ibutton_update(crc8, OW_ROM[ow_search_byte]);  // accumulate the CRC
+        ow_search_byte++;
+        ow_search_mask = 1;
+    }
+
+    return search_direction;
+}
+
+// zakocz przebieg wyszukiwania (zwraca 1, gdy w OW_ROM jest kod kolejnego urzdzenia)
+unsigned char ow_search_end()
+{
+    unsigned char search_result = 0;
+
+    // if the search was successful then (CRC omiu bajtw kodu ROM wynosi 0 - kod odczytany bez przekama)
+    if (!((ow_search_bit < 65) || (crc8 != 0)))
+    {
+        // search successful so set LastDiscrepancy,LastDeviceFlag,search_result
+        LastDiscrepancy = ow_search_last_zero;
+
+        // check for last device
+        if (LastDiscrepancy == 0)
+        {
+            LastDeviceFlag = 1;
+        }
+        search_result = 1;
+    }
             
     //if no device found then reset counters so next 'search' will be like a first
     if (!search_result || !OW_ROM[0])
@@ -314,4 +619,3 @@ unsigned char ow_search()
 
    	return search_result;
 }
-
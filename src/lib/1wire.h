@@ -3,12 +3,22 @@
 
 #include "../telemetry.h"
 
-// makra dla operacji na "magistrali" 1wire
-#define OW_ONE          OW_PORT |= 1<<OW_PIN
-#define OW_ZERO         OW_PORT &= ~(1<<OW_PIN)
-#define OW_OUTPUT       DDR(OW_PORT) |= 1<<OW_PIN
-#define OW_INPUT        DDR(OW_PORT) &= ~(1<<OW_PIN)
-#define OW_READ         (PIN(OW_PORT) & (1<<OW_PIN))
+// makra dla operacji na "magistrali" 1wire (wybranej przez ow_select_bus)
+#define OW_ONE          OW_PORT |= ow_mask
+#define OW_ZERO         OW_PORT &= ~ow_mask
+#define OW_OUTPUT       DDR(OW_PORT) |= ow_mask
+#define OW_INPUT        DDR(OW_PORT) &= ~ow_mask
+#define OW_READ         (PIN(OW_PORT) & ow_mask)
+
+// bity kolejnych magistral w porcie OW_PORT / magistrala operacji blokujcych
+unsigned char ow_bus_mask[OW_BUSES];
+unsigned char ow_mask;
+
+// inicjalizacja tablicy magistral (wybrana pierwsza)
+void ow_init();
+
+// wybierz magistral dla operacji blokujcych (reset, odczyt/zapis, wyszukiwanie)
+#define ow_select_bus(n)    ( ow_mask = ow_bus_mask[(n)] )
 
 // makra dla opoznien z noty AN126 Maxima
 // AVR-GCC: "The maximal possible delay is 768 us / F_CPU in MHz"
@@ -47,6 +57,69 @@ void ow_read_rom_code(unsigned char*);
 // wybierz (Match ROM) slave'a na magistrali 1wire
 void ow_match_rom(unsigned char*);
 
+//
+// transakcje w tle: reset + zapis tx bajtw + odczyt rx bajtw, na wybranych magistralach
+// rwnolegle - kada szczelina ustawia i prbkuje piny wszystkich magistral jednym dostpem
+// do portu (bajty zapisywane mog by rne na kadej magistrali)
+//
+// fazy szczelin odmierza przerwanie Output Compare B Timera1 (0,5 us / takt, licznik
+// zerowany co 25 ms przez Output Compare A) - przerwania wyczone tylko na czas
+// fragmentw szczelin wymagajcych dokadnoci (odczyt/zapis "1": ~15 us, zapis "0"
+// i prbkowanie zgoszenia: 60-70 us), pozostae odstpy upywaj poza przerwaniem
+//
+#define OW_TX_MAX       13      // Match ROM (9) + polecenie + parametry (Write Scratchpad: 3)
+#define OW_RX_MAX       9       // scratchpad
+
+#define OW_STATE_IDLE       0
+#define OW_STATE_RESET      1   // pocztek impulsu resetu
+#define OW_STATE_PRESENCE   2   // koniec impulsu resetu - prbkowanie zgoszenia
+#define OW_STATE_BITS       3   // kolejne szczeliny zapisu / odczytu
+#define OW_STATE_POLL       4   // szczeliny odczytu a do "1" na wszystkich magistralach (koniec pomiaru)
+#define OW_STATE_SEARCH     5   // wyszukiwanie: bit, dopenienie, kierunek (po jednej szczelinie)
+
+// czas w taktach Timera1 (preskaler 8)
+#define OW_TICKS(us)        ( (us) * (F_CPU / 8 / 1000000UL) )
+
+// odstp midzy szczelinami (zapas na powrt z przerwania przed porwnaniem)
+#define OW_RECOVERY_US      10
+
+// odpytywanie zakoczenia operacji (np. pomiaru DS18B20): odstp szczelin odczytu i ich limit (ok. 1 s)
+#define OW_POLL_US          5000
+#define OW_POLL_MAX         200
+
+volatile unsigned char ow_state;
+unsigned char ow_tx[OW_BUSES][OW_TX_MAX];   // wypeniane przed ow_start
+unsigned char ow_rx[OW_BUSES][OW_RX_MAX];
+unsigned char ow_active;                    // piny magistral biorcych udzia w transakcji
+unsigned char ow_buses;                     // magistrale (numery bitw) biorce udzia w transakcji
+unsigned char ow_tx_len;
+unsigned char ow_len;                   // tx + rx bajtw transakcji
+unsigned char ow_poll;                  // po zapisie: 1 - odpytuj zakoczenie operacji, 2 - wyszukiwanie
+unsigned char ow_ready;                 // magistrale, ktre zgosiy zakoczenie operacji
+unsigned char ow_poll_count;
+volatile unsigned char ow_pos;          // biecy bajt
+volatile unsigned char ow_bit;          // biecy bit
+void (*ow_done)(unsigned char);         // wywoywana (w przerwaniu) po zakoczeniu transakcji z mask magistral, ktre si zgosiy
+
+// rozpocznij transakcj na magistralach z maski (zwraca 0, gdy trwa poprzednia)
+unsigned char ow_start(unsigned char, unsigned char, unsigned char, void (*)(unsigned char));
+
+// jak ow_start, ale po zapisie odpytuj szczelinami odczytu zakoczenie operacji - do ow_done
+// trafiaj magistrale, ktre je zgosiy (pozostae po OW_POLL_MAX prbach)
+unsigned char ow_start_poll(unsigned char, unsigned char, void (*)(unsigned char));
+
+// szczelina odczytu na magistralach ow_active (zwraca stan pinw portu)
+unsigned char ow_read_slot();
+
+// czy trwa transakcja
+#define ow_busy()           ( ow_state != OW_STATE_IDLE )
+
+// obsuga przerwania Output Compare B Timera1
+void ow_on_timer();
+
+// zaplanuj kolejn faz za <n> us
+void ow_schedule(unsigned int);
+
 // szukanie urzadzen 1wire (kodow ROM)
 unsigned char OW_ROM[8];
 int LastDiscrepancy;
@@ -54,6 +127,29 @@ int LastFamilyDiscrepancy;
 int LastDeviceFlag;
 unsigned char crc8;
 
+// polecenie wyszukiwania: Search ROM / Alarm Search (tylko urzdzenia z flag alarmu)
+#define OW_SEARCH_ROM       0xF0
+#define OW_SEARCH_ALARM     0xEC
+
+unsigned char ow_search_cmd;
+
+// stan przebiegu wyszukiwania (kolejne bity kodu ROM)
+unsigned char ow_search_bit;
+unsigned char ow_search_last_zero;
+unsigned char ow_search_byte;
+unsigned char ow_search_mask;
+
+// przebieg wyszukiwania: pocztek / kolejny bit (zwraca kierunek) / koniec (zwraca wynik)
+void ow_search_begin();
+unsigned char ow_search_step(unsigned char, unsigned char);
+unsigned char ow_search_end();
+
+// pocztek przeszukiwania magistrali (kolejne przebiegi jak ow_next_search)
+#define ow_search_reset()   { LastDiscrepancy = 0; LastDeviceFlag = 0; LastFamilyDiscrepancy = 0; }
+
+// przebieg wyszukiwania w tle na jednej magistrali (polecenie, funkcja wywoywana z wynikiem)
+unsigned char ow_start_search(unsigned char, unsigned char, void (*)(unsigned char));
+
 // znajdz pierwsze urzadzenie 1wire 
 unsigned char ow_first_search();
 
@@ -0,0 +1,257 @@
+#include "adc.h"
+
+// preskalery Timer2 (CS22:0 = 1..7) jako przesunicia bitowe: 1, 8, 32, 64, 128, 256, 1024
+const unsigned char adc_timer_shift[] PROGMEM = {0, 3, 5, 6, 7, 8, 10};
+
+void adc_init()
+{
+    // przetwornik wyczony do czasu rozpoczcia akwizycji
+    ADCSRA = 0;
+
+    adc_mode = ADC_MODE_OFF;
+    adc_valid = 0;
+    adc_ready = 0;
+    adc_file_blocks = 0;
+}
+
+unsigned char adc_start(unsigned char mode, unsigned int rate, unsigned char* scan, unsigned char len)
+{
+    unsigned char n, cs = 0;
+    unsigned long ticks = 0;
+
+    adc_stop();
+
+    if ( (len == 0) || (len > ADC_SCAN_MAX) ) {
+        return 0;
+    }
+
+    // tylko wejcia PORTA nieuywane przez sterownik PWM
+    for (n = 0; n < len; n++) {
+        if ( (scan[n] > 7) || !(ADC_MASK & (1 << scan[n])) ) {
+            return 0;
+        }
+    }
+
+    if (mode == ADC_MODE_TIMER) {
+        // Timer2 generuje sprztowy PWM
+        if ( pwm_timer2_used() || (rate < ADC_RATE_MIN) || (rate > ADC_RATE_MAX) ) {
+            return 0;
+        }
+
+        // najmniejszy preskaler, przy ktrym okres mieci si w 8-bitowym OCR2
+        for (cs = 0; cs < sizeof(adc_timer_shift); cs++) {
+            ticks = (F_CPU >> pgm_read_byte(&adc_timer_shift[cs])) / rate;
+
+            if (ticks <= 256) {
+                break;
+            }
+        }
+    }
+    else if (mode != ADC_MODE_FREE) {
+        return 0;
+    }
+
+    // lista kanaw - prbki po decymacji oznaczone pozycj na licie
+    memcpy((void*)adc_scan, (void*)scan, len);
+    adc_scan_len  = len;
+    adc_block_len = ADC_BLOCK_SIZE;
+
+    // wspczynniki decymacji kanaw listy
+    for (n = 0; n < len; n++) {
+        adc_decimation[n] = (my_config.adc_decimation[scan[n]] > ADC_DECIMATION_MAX) ? ADC_DECIMATION_MAX : my_config.adc_decimation[scan[n]];
+        adc_acc[n]        = 0;
+        adc_acc_count[n]  = 0;
+    }
+
+    // wejcia analogowe bez podcigania
+    for (n = 0; n < len; n++) {
+        DDRA  &= ~(1 << scan[n]);
+        PORTA &= ~(1 << scan[n]);
+    }
+
+    adc_fill      = 0;
+    adc_pos       = 0;
+    adc_ready     = 0;
+    adc_valid     = 0;
+    adc_block_seq = 0;
+    adc_overruns  = 0;
+    adc_scan_pos  = 0;
+
+    ADMUX = ADC_REF | adc_scan[0];
+
+    adc_mode = mode;
+
+    if (mode == ADC_MODE_FREE) {
+        // kolejne przetwarzanie startuje zaraz po poprzednim - pierwszy wynik odrzucany (zmiana kanau z opnieniem)
+        adc_skip = 1;
+
+        SFIOR &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+        ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+    }
+    else {
+        adc_skip = 0;
+
+        ADCSRA = (1 << ADEN) | (1 << ADIE) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+
+        // Timer2 w trybie CTC wyzwala kolejne przetwarzania
+        OCR2  = ticks - 1;
+        TCNT2 = 0;
+        TCCR2 = (1 << WGM21) | (cs + 1);
+        TIMSK |= (1 << OCIE2);
+    }
+
+    rs_text_P(PSTR("ADC: start x")); rs_int(len); rs_newline();
+
+    return 1;
+}
+
+void adc_stop()
+{
+    TIMSK &= ~(1 << OCIE2);
+    ADCSRA = 0;
+
+    if ( !pwm_timer2_used() ) {
+        TCCR2 = 0;
+    }
+
+    adc_mode = ADC_MODE_OFF;
+
+    // zamknij plik z zapisywanymi blokami
+    if (adc_file_blocks > 0) {
+        adc_file_blocks = 0;
+        fat_file_close(&adc_file);
+    }
+}
+
+unsigned char adc_record(char* name, unsigned int blocks)
+{
+    char fname[8];
+
+    if ( (adc_mode == ADC_MODE_OFF) || (adc_file_blocks > 0) || (blocks == 0) || !strlen(name) || !fat_is_mounted() ) {
+        return 0;
+    }
+
+    // nazwa pliku FAT uzupeniona spacjami do 8 znakw
+    memset((void*)fname, ' ', 8);
+    memcpy((void*)fname, (void*)name, (strlen(name) > 8) ? 8 : strlen(name));
+
+    if ( !fat_file_open(&adc_file, (unsigned char*)fname, (unsigned char*)"adc") ) {
+        return 0;
+    }
+
+    // bloki dopisywane od nastpnego penego
+    adc_ready = 0;
+    adc_file_blocks = blocks;
+
+    return 1;
+}
+
+void adc_pooling()
+{
+    unsigned int seq;
+
+    if (!adc_ready) {
+        return;
+    }
+
+    adc_ready = 0;
+
+    // wyzwalacze rejestracji zdarze (mog rozpocz zapis od biecego bloku)
+    daq_trigger_adc((unsigned int*)adc_last_block());
+
+    // dopisz blok do pliku
+    if (adc_file_blocks > 0) {
+        seq = adc_block_seq;
+
+        fat_file_write(&adc_file, (unsigned char*)adc_last_block(), adc_block_len * sizeof(unsigned int));
+
+        // w trakcie zapisu zapeniono kolejny blok - zapisywany bufor by ju nadpisywany
+        if ( (seq != adc_block_seq) && (adc_overruns < 0xff) ) {
+            adc_overruns++;
+        }
+
+        if (--adc_file_blocks == 0) {
+            fat_file_close(&adc_file);
+
+            rs_text_P(PSTR("ADC: zakonczono zapis do pliku")); rs_newline();
+        }
+    }
+}
+
+unsigned int adc_get_seq()
+{
+    unsigned char sreg = SREG;
+    unsigned int seq;
+
+    cli();
+    seq = adc_block_seq;
+    SREG = sreg;
+
+    return seq;
+}
+
+unsigned int adc_copy_block(unsigned int* dst)
+{
+    unsigned int seq;
+
+    do {
+        seq = adc_get_seq();
+
+        memcpy((void*)dst, (void*)adc_buf[adc_fill ^ 1], adc_block_len * sizeof(unsigned int));
+    } while ( seq != adc_get_seq() );
+
+    return seq;
+}
+
+void adc_on_conversion()
+{
+    unsigned char next, pos = adc_scan_pos;
+    unsigned int value = ADCW;
+
+    // free-running: drugie przetwarzanie wystartowao jeszcze z pierwszym kanaem listy
+    if (adc_skip) {
+        adc_skip = 0;
+        ADMUX = ADC_REF | adc_scan[1 % adc_scan_len];
+        return;
+    }
+
+    // kana kolejnego przetwarzania (w trybie free-running kolejne ju trwa - ustaw kana dla nastpnego)
+    if (++adc_scan_pos == adc_scan_len) {
+        adc_scan_pos = 0;
+    }
+
+    next = adc_scan_pos + ((adc_mode == ADC_MODE_FREE) ? 1 : 0);
+
+    if (next >= adc_scan_len) {
+        next -= adc_scan_len;
+    }
+
+    ADMUX = ADC_REF | adc_scan[next];
+
+    // decymacja: akumuluj 2^n prbek, do bloku trafia suma przeskalowana do 10 + n/2 bitw
+    adc_acc[pos] += value;
+
+    if ( ++adc_acc_count[pos] < (1 << adc_decimation[pos]) ) {
+        return;
+    }
+
+    adc_buf[adc_fill][adc_pos++] = (pos << 13) | (adc_acc[pos] >> ((adc_decimation[pos] + 1) >> 1));
+
+    adc_acc[pos]       = 0;
+    adc_acc_count[pos] = 0;
+
+    // blok peny - zamie bufory
+    if (adc_pos == adc_block_len) {
+
+        // poprzedni blok nie zosta odebrany
+        if ( adc_ready && (adc_overruns < 0xff) ) {
+            adc_overruns++;
+        }
+
+        adc_fill ^= 1;
+        adc_pos   = 0;
+        adc_ready = 1;
+        adc_valid = 1;
+        adc_block_seq++;
+    }
+}
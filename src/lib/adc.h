@@ -0,0 +1,80 @@
+#ifndef _ADC_H
+#define _ADC_H
+
+#include "../telemetry.h"
+
+// tryby pracy przetwornika
+#define ADC_MODE_OFF        0
+#define ADC_MODE_FREE       1       // free-running - preskaler 128 (125 kHz), ok. 9,6 tys. prbek/s
+#define ADC_MODE_TIMER      2       // pojedyncze przetwarzania wyzwalane przerwaniem Timer2 (CTC)
+
+// maksymalna dugo listy skanowanych kanaw
+#define ADC_SCAN_MAX        8
+
+// decymacja (akumulacja i zrzut): maks. log2 wspczynnika - suma 64 prbek 10-bitowych mieci si w 16 bitach
+#define ADC_DECIMATION_MAX  6
+
+// prbka w bloku: pozycja kanau na licie (3 bity) | warto po decymacji (do 13 bitw)
+#define ADC_SAMPLE_POS(v)   ( (v) >> 13 )
+#define ADC_SAMPLE_VALUE(v) ( (v) & 0x1fff )
+
+// zakres czstotliwoci prbkowania w trybie ADC_MODE_TIMER (suma po kanaach listy)
+#define ADC_RATE_MIN        62      // F_CPU / 1024 / 256
+#define ADC_RATE_MAX        8000    // przetwarzanie trwa 13 cykli zegara ADC (104 us)
+
+// bufor podwjny: blok zapeniany w przerwaniu / ostatni peny blok
+volatile unsigned int adc_buf[2][ADC_BLOCK_SIZE];
+
+volatile unsigned char adc_fill;        // numer bufora zapenianego w przerwaniu
+volatile unsigned char adc_pos;         // pozycja w zapenianym buforze
+volatile unsigned char adc_ready;       // peny blok czeka na odbir (zapis na kart)
+volatile unsigned char adc_valid;       // w buforze adc_fill^1 jest peny blok
+volatile unsigned int  adc_block_seq;   // numer ostatniego penego bloku
+volatile unsigned char adc_overruns;    // bloki nadpisane przed odbiorem
+
+// lista skanowanych kanaw (kolejno prbek w bloku)
+unsigned char adc_mode;
+unsigned char adc_scan[ADC_SCAN_MAX];
+unsigned char adc_scan_len;
+unsigned char adc_block_len;            // liczba prbek w bloku
+volatile unsigned char adc_scan_pos;    // pozycja na licie kanau koczcego si przetwarzania
+volatile unsigned char adc_skip;        // odrzu wynik (pierwsze przetwarzanie w trybie free-running)
+
+// stan filtrw decymujcych kolejnych pozycji listy
+unsigned int  adc_acc[ADC_SCAN_MAX];    // suma prbek biecego okresu
+unsigned char adc_acc_count[ADC_SCAN_MAX];
+unsigned char adc_decimation[ADC_SCAN_MAX]; // log2 wspczynnika (z my_config)
+
+// zapis kolejnych blokw do pliku <nazwa>.ADC na partycji FAT
+fat_file adc_file;
+unsigned int adc_file_blocks;
+
+// inicjalizacja (przetwornik wyczony)
+void adc_init();
+
+// start akwizycji (tryb, czstotliwo prbkowania, lista kanaw, dugo listy)
+unsigned char adc_start(unsigned char, unsigned int, unsigned char*, unsigned char);
+
+// zatrzymaj akwizycj
+void adc_stop();
+
+// zapisuj <n> kolejnych blokw do pliku na partycji FAT
+unsigned char adc_record(char*, unsigned int);
+
+// odbierz gotowy blok (zadanie ptli gwnej, co 25 ms)
+void adc_pooling();
+
+// ostatni peny blok (lub 0, gdy brak) - moe zosta zamieniony w przerwaniu
+#define adc_last_block()    ( adc_valid ? (unsigned int*)adc_buf[adc_fill ^ 1] : 0 )
+
+// numer ostatniego penego bloku (odczyt poza przerwaniem)
+unsigned int adc_get_seq();
+
+// kopiuj ostatni peny blok (adc_block_len prbek, ponawiane po zamianie buforw w trakcie kopiowania) - zwraca numer bloku
+unsigned int adc_copy_block(unsigned int*);
+
+// obsuga przerwa (wynik przetwarzania / wyzwolenie przetwarzania przez Timer2)
+void adc_on_conversion();
+#define adc_on_timer()      ( ADCSRA |= (1 << ADSC) )
+
+#endif
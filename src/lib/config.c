@@ -9,6 +9,9 @@ unsigned char config_read(config* cfg) {
     memset((void*) cfg, 0, sizeof(config));
 
     eeprom_read_block((void*) cfg, &config_eeprom, sizeof(config));
+
+    config_save_pos = sizeof(config);
+
     return (cfg->header == CONFIG_HEADER) ? 1 : 0;
 }
 
@@ -20,10 +23,32 @@ unsigned char config_save(config* cfg) {
     return 1;
 }
 
+unsigned char config_save_step(config* cfg) {
+
+    cfg->header = CONFIG_HEADER;
+
+    // poprzedni bajt jeszcze w zapisie
+    if ( !eeprom_is_ready() ) {
+        return 1;
+    }
+
+    // zapisuj tylko bajty rne od zawartoci EEPROM
+    for (; config_save_pos < sizeof(config); config_save_pos++) {
+        if ( eeprom_read_byte((uint8_t*)&config_eeprom + config_save_pos) != ((unsigned char*)cfg)[config_save_pos] ) {
+            eeprom_write_byte((uint8_t*)&config_eeprom + config_save_pos, ((unsigned char*)cfg)[config_save_pos]);
+            config_save_pos++;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 
 void config_menu() {
 
-    unsigned char tmp;
+    unsigned char tmp, ch;
 
     lcd_clear();
     //               0123456789012345
@@ -42,7 +67,11 @@ void config_menu() {
     rs_text_P(PSTR("2) IP bramy")); rs_newline();
     rs_text_P(PSTR("3) maska")); rs_newline();
     rs_text_P(PSTR("4) DHCP")); rs_newline();
-    rs_text_P(PSTR("5) przypisania czujnikow DS do kanalow")); rs_newline();
+    rs_text_P(PSTR("5) zamiana kanalow czujnikow DS")); rs_newline();
+    rs_text_P(PSTR("6) decymacja wejsc ADC")); rs_newline();
+    rs_text_P(PSTR("7) grupa multicast")); rs_newline();
+    rs_text_P(PSTR("8) okresy probkowania kanalow DS")); rs_newline();
+    rs_text_P(PSTR("9) progi alarmowe kanalow DS")); rs_newline();
 
     rs_text_P(PSTR("z)apisz ustawienia")); rs_newline();
     rs_text_P(PSTR("r)eset systemu")); rs_newline();
@@ -81,19 +110,92 @@ void config_menu() {
 
             case '5':
                 // patrz komentarz w ds18b20.c
-                for (tmp=0; tmp < ds_devices_count; tmp++) {
+                rs_text_P(PSTR("Podaj kanaly do zamiany: "));
+
+                tmp = config_get_num();
+                rs_send('/');
+                ch  = config_get_num();
+
+                if ( (tmp < DS_DEVICES_MAX) && (ch < DS_DEVICES_MAX) ) {
+                    ds18b20_swap(tmp, ch);
+                }
+                
+                break;
+
+            case '6':
+                // nadprbkowanie 2^n prbek -> n/2 dodatkowych bitw rozdzielczoci
+                for (tmp=0; tmp < 8; tmp++) {
+                    if ( !(ADC_MASK & (1 << tmp)) ) {
+                        continue;
+                    }
+
                     rs_newline();
-                    rs_text_P(PSTR("Podaj przypisanie kanalu dla czujnika #"));
+                    rs_text_P(PSTR("Podaj log2 wspolczynnika decymacji (0-6) dla wejscia ADC #"));
                     rs_int(tmp);
 
                     rs_send(' ');
                     rs_send('[');
-                    rs_int(my_config.ds_assignment[tmp]);
+                    rs_int(my_config.adc_decimation[tmp]);
                     rs_send(']');
 
-                    my_config.ds_assignment[tmp] = config_get_num();
+                    my_config.adc_decimation[tmp] = config_get_num();
+
+                    if (my_config.adc_decimation[tmp] > ADC_DECIMATION_MAX) {
+                        my_config.adc_decimation[tmp] = ADC_DECIMATION_MAX;
+                    }
                 }
-                
+
+                break;
+
+            case '7':
+                rs_text_P(PSTR("Podaj adres grupy multicast (224.0.0.0 - 239.255.255.255): "));
+                config_ip(my_config.mcast_group);
+
+                rs_newline();
+                rs_text_P(PSTR("Podaj okres publikacji w sekundach (0 - wylaczona) ["));
+                rs_int(my_config.mcast_interval);
+                rs_send(']');
+
+                my_config.mcast_interval = config_get_num();
+                break;
+
+            case '8':
+                // krtszy okres -> nisza rozdzielczo (czas pomiaru 94 - 750 ms)
+                for (tmp=0; tmp < DS_DEVICES_MAX; tmp++) {
+                    rs_newline();
+                    rs_text_P(PSTR("Podaj okres probkowania (x100 ms, 0 - 1 s) kanalu #"));
+                    rs_int(tmp);
+
+                    rs_send(' ');
+                    rs_send('[');
+                    rs_int(my_config.ds_period[tmp]);
+                    rs_send(']');
+
+                    my_config.ds_period[tmp] = config_get_num();
+                }
+
+                break;
+
+            case '9':
+                // poza zakresem TL..TH czujnik ustawia flag alarmu (TL = TH - kana odczytywany zawsze)
+                for (tmp=0; tmp < DS_DEVICES_MAX; tmp++) {
+                    rs_newline();
+                    rs_text_P(PSTR("Podaj progi TL / TH kanalu #"));
+                    rs_int(tmp);
+
+                    rs_send(' ');
+                    rs_send('[');
+                    rs_int(my_config.ds_alarm_low[tmp]);
+                    rs_send('/');
+                    rs_int(my_config.ds_alarm_high[tmp]);
+                    rs_send(']');
+                    rs_send(' ');
+
+                    my_config.ds_alarm_low[tmp] = config_get_temp();
+                    rs_send('/');
+                    my_config.ds_alarm_high[tmp] = config_get_temp();
+                }
+
                 break;
 
             case 'z':
@@ -181,3 +283,37 @@ unsigned char config_get_num() {
 
     return (ch - '0');
 }
+
+signed char config_get_temp() {
+
+    unsigned char ch;
+    unsigned char pos = 0;
+    signed int val;
+    char buf[5];
+
+    // znak i do trzech cyfr
+    while (pos < 4) {
+        ch = rs_recv();
+
+        if ( (ch == '-') && (pos == 0) ) {
+            rs_send(ch);
+            buf[pos++] = ch;
+        }
+        if ( ch >= '0' && ch <= '9' ) {
+            rs_send(ch);
+            buf[pos++] = ch;
+        }
+        if ( (ch == '\r') && (pos > 0) ) {
+            break;
+        }
+    }
+
+    buf[pos] = 0;
+
+    val = atoi(buf);
+
+    if (val > 127)  val = 127;
+    if (val < -128) val = -128;
+
+    return (signed char) val;
+}
@@ -14,18 +14,49 @@ typedef struct {
     uint8_t       gate_ip[4];
     uint8_t       mask[4];
 
-    // przypisania czujnikw DS18B20 do kanaw pomiarowych
+    // kody ROM czujnikw DS18B20 przypisanych do kanaw pomiarowych (family code 0 - kana wolny)
     // patrz komentarz w ds18b20.c
-    unsigned char ds_assignment[DS_DEVICES_MAX];
+    unsigned char ds_rom[DS_DEVICES_MAX][8];
+
+    // wymagany okres prbkowania kanaw DS18B20 (x 100 ms, 0 - 1 s) - wyznacza rozdzielczo pomiaru
+    unsigned char ds_period[DS_DEVICES_MAX];
+
+    // progi alarmowe kanaw DS18B20 (st. C) - przy TL < TH kana odczytywany tylko po wykryciu alarmu (Alarm Search)
+    signed char   ds_alarm_low[DS_DEVICES_MAX];
+    signed char   ds_alarm_high[DS_DEVICES_MAX];
+
+    // strefy regulacji PID: kana DS18B20 (0xff - strefa wyczona), kana PWM,
+    // warto zadana (0,1 st. C jak ds_temp) i wsp. P, I, D (x PID_SCALING_FACTOR)
+    unsigned char pid_sensor[PID_COUNT];
+    unsigned char pid_pwm[PID_COUNT];
+    signed int    pid_sp[PID_COUNT];
+    unsigned int  pid_gains[PID_COUNT][3];
 
     // ustawienia typu tak/nie (maska bitowa)
     unsigned int  config;
+
+    // decymacja wej ADC: log2 wspczynnika nadprbkowania (0 - bez decymacji, maks. ADC_DECIMATION_MAX)
+    unsigned char adc_decimation[8];
+
+    // publikacja pomiarw w grupie multicast (na port DAQ_PORT): adres grupy, okres w sekundach (0 - wyczona)
+    uint8_t       mcast_group[4];
+    unsigned char mcast_interval;
 } config;
 
+// ustawienia zmienione w przerwaniu - zapis do EEPROM z ptli gwnej
+volatile unsigned char config_changed;
+
 // odczyt / zapis konfiguracji
 unsigned char config_read(config*);
 unsigned char config_save(config*);
 
+// zapis w tle: jeden zmieniony bajt na wywoanie, bez czekania na zakoczenie zapisu (ok. 8,5 ms na bajt)
+// zwraca 0, gdy w EEPROM s ju wszystkie zmiany
+unsigned char config_save_step(config*);
+
+// pozycja zapisu w tle (sizeof(config) - brak zmian do zapisania)
+unsigned int  config_save_pos;
+
 // menu konfiguracyjne w terminalu
 void config_menu();
 
@@ -38,8 +69,11 @@ void config_ip(uint8_t* ip);
 // zwraca wybran cyfr
 unsigned char config_get_num();
 
+// czeka na wprowadzenie temperatury w st. C (-128..127, zatwierdzana enterem)
+signed char config_get_temp();
+
 // nagwek struktury (zmie warto po zmianie struktury typu config)
-#define CONFIG_HEADER   0xA2
+#define CONFIG_HEADER   0xA8
 
 // maska bitowa na pole config
 #define CONFIG_USE_DHCP 1
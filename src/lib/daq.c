@@ -41,12 +41,47 @@ unsigned int daq_handle_packet(unsigned char* data) {
                 case DAQ_CMD_READ_TEMPERATURE:
                     return daq_read_temperature(data);
 
+                // wartoci zadane stref PID
+                case DAQ_CMD_READ_SET_POINTS:
+                    memcpy((void*)data, (void*)my_config.pid_sp, sizeof(my_config.pid_sp));
+                    return sizeof(my_config.pid_sp);
+
+                // stan stref PID (ustawienia, wyjcia, czasy przebiegw)
+                case DAQ_CMD_READ_PID_OUTPUT:
+                    return daq_read_pid(data);
+
+                // stan strojenia regulatora
+                case DAQ_CMD_READ_PID_TUNE:
+                    ((daq_tune_record*)data)->zone   = pid_tune.zone;
+                    ((daq_tune_record*)data)->state  = pid_tune.state;
+                    ((daq_tune_record*)data)->rule   = pid_tune.rule;
+                    ((daq_tune_record*)data)->cycles = pid_tune.cycles;
+                    ((daq_tune_record*)data)->ku     = pid_tune.ku;
+                    ((daq_tune_record*)data)->tu     = pid_tune.tu;
+                    return sizeof(daq_tune_record);
+
                 // wypenienia kanaw PWM
                 case DAQ_CMD_READ_PWM_FILL:
                     for (len=0; len < PWM_CHANNELS; len++) {
                         data[len] = pwm_get_fill(len);
                     }
                     return PWM_CHANNELS * sizeof(unsigned char);
+
+                // prbki zapisanego zadania akwizycji
+                case DAQ_CMD_READ_DATA:
+                    return daq_read_data(data);
+
+                // prbki kanau z zakresu czasu
+                case DAQ_CMD_READ_SERIES:
+                    return daq_read_series(data);
+
+                // ostatni blok prbek ADC
+                case DAQ_CMD_READ_ADC:
+                    return daq_read_adc(data);
+
+                // migawka stanu (temperatury, PWM, PID, ADC) w jednym pakiecie
+                case DAQ_CMD_READ_SNAPSHOT:
+                    return daq_read_snapshot(data);
             }
 
             break;
@@ -59,6 +94,53 @@ unsigned int daq_handle_packet(unsigned char* data) {
                 case DAQ_CMD_SET_PWM_FILL:
                     pwm_set_fill( (data[2]-'0') % PWM_CHANNELS, atoi( (char*)data+3) );
                     return 0;
+
+                // wypenienia kilku kanaw PWM naraz
+                case DAQ_CMD_SET_PWM_BATCH:
+                    if ( daq_set_pwm_batch(data) ) {
+                        return 0;
+                    }
+                    break;
+
+                // strefa PID: sp<nr>,<definicja> / sp<nr> - wycz
+                case DAQ_CMD_SET_PID:
+                    if ( pid_zone_set(data[2] - '0', (data[3] == ',') ? (char*)data+4 : 0) ) {
+                        return 0;
+                    }
+                    break;
+
+                // strojenie strefy PID: sn<nr>,<definicja> / sn - przerwij
+                case DAQ_CMD_SET_PID_TUNE:
+                    if ( pid_tune_start(data[2] - '0', (data[3] == ',') ? (char*)data+4 : 0) ) {
+                        return 0;
+                    }
+                    break;
+
+                // start / stop akwizycji z przetwornika ADC
+                case DAQ_CMD_SET_ADC:
+                    if ( daq_set_adc(data) ) {
+                        return 0;
+                    }
+                    break;
+
+                // wyzwalacz rejestracji zdarze: st<nr>,<definicja> / st<nr> - wycz
+                case DAQ_CMD_SET_TRIGGER:
+                    if ( daq_trigger_set(data[2] - '0', (data[3] == ',') ? (char*)data+4 : 0) ) {
+                        return 0;
+                    }
+                    break;
+
+                // zapis kolejnych blokw ADC do pliku
+                case DAQ_CMD_SET_ADC_RECORD:
+                    if ( strchr((char*)data+2, ',') ) {
+                        char* pos = strchr((char*)data+2, ',');
+                        *pos = 0;
+
+                        if ( adc_record((char*)data+2, atoi(pos+1)) ) {
+                            return 0;
+                        }
+                    }
+                    break;
             }
 
             break;
@@ -92,60 +174,867 @@ unsigned int daq_read_temperature(unsigned char* data) {
     return size;
 }
 
-unsigned int daq_start(char* name, unsigned char ch, unsigned int interval, unsigned int samples) {
+unsigned int daq_read_data(unsigned char* data) {
+
+    char name[9];
+    unsigned char n, c, ch = 0xFF;
+    unsigned int offset = 0, count = 0, i;
+    signed int value;
+    char* pos;
+
+    fs_file fp;
+    daq_header header;
+    journal_cursor cur;
+
+    // nazwa pliku (do 8 znakw: litery, cyfry, '_', '-')
+    for (n = 0; n < 8; n++) {
+        c = data[2+n];
+
+        if ( !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-') ) {
+            break;
+        }
+
+        name[n] = c;
+    }
+    name[n] = 0;
+
+    // opcjonalnie numer pierwszej prbki i kana
+    if (data[2+n] == ',') {
+        offset = atoi((char*)data+3+n);
+
+        pos = strchr((char*)data+3+n, ',');
+
+        if (pos) {
+            ch = atoi(pos+1);
+        }
+    }
+
+    if ( !n || !fs_open(&fp, (unsigned char*)name, FS_DONT_CREATE) || !fs_read(&fp, (unsigned char*)&header, sizeof(daq_header)) ) {
+        data[0] = 'e';
+        data[1] = 'r';
+        data[2] = 'r';
+
+        return 3;
+    }
+
+    // prbki dekodowane w locie z dziennika pomiarw
+    daq_cursor_init(&cur, &header, ch);
+
+    for (i = 0; (i < header.samples) && (count < DAQ_READ_DATA_MAX) && journal_cursor_next(&cur, &value, 0); i++) {
+
+        // pomi prbki przed dan
+        if (i < offset) {
+            continue;
+        }
+
+        // little endian - intel / avr
+        data[count*2]   = value & 0xff;
+        data[count*2+1] = value >> 8;
+        count++;
+    }
+
+    fs_close(&fp);
+
+    return count * sizeof(signed int);
+}
+
+unsigned int daq_read_series(unsigned char* data) {
+
+    unsigned char ch;
+    unsigned int count = 0;
+    unsigned long from, to, timestamp;
+    signed int value;
+    char* pos;
+
+    journal_cursor cur;
+
+    // parsuj zapytanie: <kana>,<od>,<do>
+    ch = atoi((char*)data+2);
+
+    pos = strchr((char*)data+2, ',');
+    from = pos ? atol(pos+1) : 0;
+
+    pos = pos ? strchr(pos+1, ',') : 0;
+    to = pos ? atol(pos+1) : 0;
+
+    if ( !journal_is_ready() || (ch >= DS_DEVICES_MAX) || !pos || (from > to) ) {
+        data[0] = 'e';
+        data[1] = 'r';
+        data[2] = 'r';
+
+        return 3;
+    }
+
+    // wyszukiwanie binarne sektorw dziennika obejmujcych pocztek zakresu
+    journal_cursor_seek(&cur, ch, from);
+
+    while ( (count < DAQ_READ_SERIES_MAX) && journal_cursor_next(&cur, &value, &timestamp) ) {
+
+        if (timestamp > to) {
+            if ( journal_cursor_past(&cur, to) ) {
+                break;
+            }
+
+            continue;
+        }
+
+        if (timestamp < from) {
+            continue;
+        }
+
+        // little endian - intel / avr
+        memcpy((void*)(data + count*6), (void*)&timestamp, sizeof(unsigned long));
+        memcpy((void*)(data + count*6 + 4), (void*)&value, sizeof(signed int));
+        count++;
+    }
+
+    return count * (sizeof(unsigned long) + sizeof(signed int));
+}
+
+unsigned int daq_read_adc(unsigned char* data) {
+
+    unsigned int seq;
+
+    if (!adc_valid) {
+        data[0] = 'e';
+        data[1] = 'r';
+        data[2] = 'r';
+
+        return 3;
+    }
+
+    // prbki kolejnych kanaw listy (spjna kopia bloku)
+    seq = adc_copy_block((unsigned int*)(data+4+adc_scan_len));
+
+    // nagwek: numer bloku (little endian), liczba blokw nieodebranych, lista kanaw
+    data[0] = seq & 0xff;
+    data[1] = seq >> 8;
+    data[2] = adc_overruns;
+    data[3] = adc_scan_len;
+
+    memcpy((void*)(data+4), (void*)adc_scan, adc_scan_len);
+
+    return 4 + adc_scan_len + adc_block_len * sizeof(unsigned int);
+}
+
+unsigned int daq_read_snapshot(unsigned char* data) {
+
+    daq_snapshot_header header;
+    unsigned int len = sizeof(daq_snapshot_header);
+    unsigned int* block;
+    unsigned int adc[8];
+    unsigned char n;
+
+    header.fields = data[2] ? atoi((char*)data+2) : DAQ_SNAPSHOT_ALL;
+
+    header.fields &= DAQ_SNAPSHOT_ALL;
+
+    if (!adc_valid) {
+        header.fields &= ~DAQ_SNAPSHOT_ADC;
+    }
+
+    header.version  = DAQ_SNAPSHOT_VERSION;
+    header.seq      = daq_snapshot_seq++;
+    header.uptime   = uptime;
+    header.time     = fs_get_time();
+    header.ds_count = ds_devices_count;
+    header.flags    = 0;
+
+    if (adc_mode != ADC_MODE_OFF) {
+        header.flags |= DAQ_SNAPSHOT_FLAG_ADC;
+    }
+
+    if (daq_tasks_running()) {
+        header.flags |= DAQ_SNAPSHOT_FLAG_DAQ;
+    }
+
+    if (fat_is_mounted()) {
+        header.flags |= DAQ_SNAPSHOT_FLAG_FAT;
+    }
+
+    for (n = 0; n < DAQ_TRIGGERS_MAX; n++) {
+        if (daq_triggers[n].state == DAQ_TRIGGER_FIRED) {
+            header.flags |= DAQ_SNAPSHOT_FLAG_TRIGGER;
+        }
+    }
+
+    // pola w kolejnoci bitw maski (nagwek wpisany na kocu - dane polecenia s ju zbdne)
+    if (header.fields & DAQ_SNAPSHOT_TEMPERATURE) {
+        memcpy((void*)(data+len), (void*)ds_temp, DS_DEVICES_MAX * sizeof(signed int));
+        len += DS_DEVICES_MAX * sizeof(signed int);
+    }
+
+    if (header.fields & DAQ_SNAPSHOT_PWM_FILL) {
+        for (n = 0; n < PWM_CHANNELS; n++) {
+            data[len++] = pwm_get_fill(n);
+        }
+    }
+
+    if (header.fields & DAQ_SNAPSHOT_PID_OUTPUT) {
+        for (n = 0; n < PID_COUNT; n++) {
+            memcpy((void*)(data+len), (void*)&pid_zones[n].output, sizeof(signed int));
+            len += sizeof(signed int);
+        }
+    }
+
+    if (header.fields & DAQ_SNAPSHOT_SET_POINTS) {
+        memcpy((void*)(data+len), (void*)my_config.pid_sp, sizeof(my_config.pid_sp));
+        len += sizeof(my_config.pid_sp);
+    }
+
+    if (header.fields & DAQ_SNAPSHOT_ADC) {
+        memset((void*)adc, 0, sizeof(adc));
+
+        // spjna kopia bloku w miejscu pola (nadpisywana wynikiem)
+        block = (unsigned int*)(data+len);
+        adc_copy_block(block);
+
+        // ostatnia prbka kadej pozycji listy skanowania trafia pod numer wejcia
+        for (n = 0; n < adc_block_len; n++) {
+            adc[ adc_scan[ADC_SAMPLE_POS(block[n])] ] = ADC_SAMPLE_VALUE(block[n]);
+        }
+
+        memcpy((void*)(data+len), (void*)adc, sizeof(adc));
+        len += sizeof(adc);
+    }
+
+    memcpy((void*)data, (void*)&header, sizeof(daq_snapshot_header));
+
+    return len;
+}
+
+unsigned int daq_read_pid(unsigned char* data) {
+
+    daq_pid_record rec;
+    unsigned char z;
+
+    for (z = 0; z < PID_COUNT; z++) {
+        rec.sensor     = pid_zone_enabled(z) ? my_config.pid_sensor[z] : 0xff;
+        rec.pwm        = my_config.pid_pwm[z];
+        rec.sp         = my_config.pid_sp[z];
+        rec.output     = pid_zones[z].output;
+#ifdef PERF
+        rec.exec       = pid_zones[z].exec;
+        rec.exec_max   = pid_zones[z].exec_max;
+        rec.jitter     = pid_zones[z].jitter;
+        rec.jitter_max = pid_zones[z].jitter_max;
+#else
+        rec.exec       = 0;
+        rec.exec_max   = 0;
+        rec.jitter     = 0;
+        rec.jitter_max = 0;
+#endif
+
+        memcpy((void*)rec.gains, (void*)my_config.pid_gains[z], sizeof(rec.gains));
+        memcpy((void*)(data + z * sizeof(daq_pid_record)), (void*)&rec, sizeof(daq_pid_record));
+    }
+
+    return PID_COUNT * sizeof(daq_pid_record);
+}
+
+unsigned char daq_set_pwm_batch(unsigned char* data) {
+
+    unsigned char ch;
+    char* pos = (char*)data+2;
+
+    // kolejne pola to wypenienia kanaw 0, 1, ... (puste pole - kana bez zmian)
+    for (ch = 0; (ch < PWM_CHANNELS) && pos; ch++) {
+        if ( (*pos >= '0') && (*pos <= '9') ) {
+            pwm_set_fill(ch, atoi(pos));
+        }
+        else if ( (*pos != ',') && (*pos != 0) ) {
+            return 0;
+        }
+
+        pos = strchr(pos, ',');
+
+        if (pos) {
+            pos++;
+        }
+    }
+
+    return 1;
+}
+
+unsigned char daq_set_adc(unsigned char* data) {
 
-    // trwa ju inne zadanie akwizycji - poczekaj na jego zakoczenie
-    if (daq_task.samples > 0) {
+    unsigned char scan[ADC_SCAN_MAX];
+    unsigned char len = 0, mode = ADC_MODE_TIMER;
+    unsigned int rate = 0;
+    char* pos;
+
+    // sa0 - zatrzymaj akwizycj
+    if (data[2] == '0') {
+        adc_stop();
+        return 1;
+    }
+
+    // saf,<kanay> - free-running / sa<czstotliwo>,<kanay> - wyzwalanie Timer2
+    if (data[2] == 'f') {
+        mode = ADC_MODE_FREE;
+    }
+    else {
+        rate = atoi((char*)data+2);
+    }
+
+    pos = strchr((char*)data+2, ',');
+
+    if (!pos) {
+        return 0;
+    }
+
+    // lista kanaw jako cig cyfr
+    for (pos++; (*pos >= '0') && (*pos <= '7') && (len < ADC_SCAN_MAX); pos++) {
+        scan[len++] = *pos - '0';
+    }
+
+    return adc_start(mode, rate, scan, len);
+}
+
+unsigned int daq_start(char* name, unsigned char mask, unsigned int interval, unsigned int samples) {
+    return daq_task_start(name, mask, interval, samples) ? 1 : 0;
+}
+
+daq_task* daq_task_start(char* name, unsigned char mask, unsigned int interval, unsigned int samples) {
+
+    unsigned char t, ch;
+    daq_task* task = 0;
+    signed int* state;
+    fs_file fp;
+
+    // wolne miejsce w tablicy zada
+    for (t = 0; t < DAQ_TASKS_MAX; t++) {
+        if (daq_tasks[t].samples == 0) {
+            task = &daq_tasks[t];
+            break;
+        }
+    }
+
+    // trwa ju maksymalna liczba zada akwizycji - poczekaj na zakoczenie ktrego z nich
+    if (!task) {
         return 0;
     }
 
+    // ramki zada w dzienniku rozrniane s mask kanaw i interwaem - dwa trwajce zadania
+    // o tych samych parametrach przeplatayby swoje prbki przy odczycie
+    for (t = 0; t < DAQ_TASKS_MAX; t++) {
+        if ( daq_tasks[t].samples && (daq_tasks[t].mask == mask) && (daq_tasks[t].interval == interval) ) {
+            return 0;
+        }
+    }
+
     // dalsze sprawdzenie poprawnoci parametrw
-    if ( (ch >= ds_devices_count) || (interval < 1) || (interval > 3600) || (samples < 1) || (samples > 200) || !strlen(name) ) {
+    if ( (mask == 0) || (mask >> ds_devices_count) || (interval < 1) || (interval > 3600) || (samples < 1) || (samples > 200) || !strlen(name) ) {
+        return 0;
+    }
+
+    // prbki zapisywane s w dzienniku pomiarw
+    if ( !journal_is_ready() ) {
         return 0;
     }
 
-    // utwrz plik na wyniki pomiarw
-    if (!fs_open(&(daq_task.fp), (unsigned char*)name, 0) || daq_task.fp.size > 0) {
+    // stan kodera ramek dla kanaw z maski
+    if ( !(state = daq_channels_alloc(mask)) ) {
         return 0;
     }
 
-    // kopiuj dane do struktury zadania DAQ
-    memcpy((void*)daq_task.name, (void*)name, strlen(name));
-    daq_task.ch = ch;
-    daq_task.interval = interval;
-    daq_task.samples = samples;
+    // utwrz plik na opis zadania
+    if (!fs_open(&fp, (unsigned char*)name, 0) || fp.size > 0) {
+        daq_channels_free(state, mask);
+        return 0;
+    }
+
+    // zapisz opis zadania - kolejne prbki zaczn si od biecego koca dziennika
+    daq_header header;
+
+    header.seq      = journal_seq;
+    header.mask     = mask;
+    header.interval = interval;
+    header.samples  = samples;
+
+    fs_write(&fp, (unsigned char*)&header, sizeof(daq_header));
+    fs_close(&fp);
+
+    memcpy((void*)task->name, (void*)fp.name, sizeof(task->name));
+
+    // prbki wszystkich kanaw z maski kodowane we wsplnych ramkach
+    journal_frame_init(&(task->frame), mask, interval, state);
+
+    task->mask     = mask;
+    task->interval = interval;
+    task->counter  = 0;
+
+    // rwnolegle zapisuj wyniki do pliku CSV czytelnego na PC
+    task->csv.name[0] = 0;
+
+    if ( fat_is_mounted() ) {
+        char fname[8];
+
+        // nazwa pliku FAT uzupeniona spacjami do 8 znakw
+        memset((void*)fname, ' ', 8);
+        memcpy((void*)fname, (void*)name, (strlen(name) > 8) ? 8 : strlen(name));
+
+        if ( fat_file_open(&(task->csv), (unsigned char*)fname, (unsigned char*)"csv") ) {
+            // nowy plik - dodaj nagwek z kolumn na kady kana
+            if (task->csv.size == 0) {
+                char row[8];
+
+                fat_file_write(&(task->csv), (unsigned char*)"czas", 4);
+
+                for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+                    if (mask & (1 << ch)) {
+                        row[0] = ';';
+                        row[1] = 'T';
+                        itoa(ch + 1, row+2, 10);
+
+                        fat_file_write(&(task->csv), (unsigned char*)row, strlen(row));
+                    }
+                }
+
+                fat_file_write(&(task->csv), (unsigned char*)"\r\n", 2);
+            }
+        }
+        else {
+            task->csv.name[0] = 0;
+        }
+    }
+
+    // od tej chwili zadanie aktywne
+    task->samples = samples;
 
     //
     // funkcja daq_pooling() dokonuje od teraz okresowego (co <interval> sekund) pomiaru <samples> prbek
     //
 
-    rs_text_P(PSTR("DAQ: rozpoczeto rejestracje do pliku ")); rs_text((char*)(daq_task.fp.name)); rs_send('\''); rs_newline();
+    rs_text_P(PSTR("DAQ: rozpoczeto rejestracje do pliku '")); rs_text((char*)(task->name)); rs_send('\''); rs_newline();
 
-    return 1;
+    return task;
+}
+
+signed int* daq_channels_alloc(unsigned char mask) {
+
+    unsigned char n = 0, first;
+    unsigned int bits;
+
+    // liczba kanaw w masce
+    for (; mask; mask >>= 1) {
+        n += mask & 1;
+    }
+
+    bits = (1U << n) - 1;
+
+    // pierwszy wolny cigy fragment
+    for (first = 0; first + n <= DAQ_CHANNELS_MAX; first++) {
+        if ( !(daq_channels_used & (bits << first)) ) {
+            daq_channels_used |= bits << first;
+            return daq_channels[first];
+        }
+    }
+
+    return 0;
+}
+
+void daq_channels_free(signed int* state, unsigned char mask) {
+
+    unsigned char n = 0;
+
+    for (; mask; mask >>= 1) {
+        n += mask & 1;
+    }
+
+    daq_channels_used &= ~( ((1U << n) - 1) << ((state - daq_channels[0]) / 2) );
 }
 
 void daq_pooling() {
-    daq_interval++;
 
-    // jeszcze / ju nie teraz
-    if ( (daq_interval < daq_task.interval) || (daq_task.samples == 0) ) 
-        return;
+    // migawka pomiarw wsplna dla wszystkich zada obsugiwanych w tym takcie
+    signed int snapshot[DS_DEVICES_MAX];
+    unsigned char t, taken = 0;
+    time_t time;
+
+    daq_task* task;
+
+    for (t = 0; t < DAQ_TASKS_MAX; t++) {
+        task = &daq_tasks[t];
+
+        // jeszcze / ju nie teraz
+        if ( (task->samples == 0) || (++task->counter < task->interval) ) {
+            continue;
+        }
+
+        task->counter = 0;
+
+        if (!taken) {
+            memcpy((void*)snapshot, (void*)ds_temp, sizeof(snapshot));
+            ds1306_time_get(&time);
+            taken = 1;
+        }
+
+        // dopisz prbk wszystkich kanaw zadania do ramki (pena ramka trafia do dziennika pomiarw)
+        journal_frame_add(&(task->frame), snapshot);
+
+        // oraz jeden wiersz do pliku CSV
+        if (task->csv.name[0]) {
+            daq_csv_write(&(task->csv), task->mask, snapshot, &time);
+        }
+
+        task->samples--;
+
+        // zakoczono zadanie
+        if (task->samples == 0) {
+            rs_text_P(PSTR("DAQ: zakonczono rejestracje do pliku '")); rs_text((char*)(task->name)); rs_send('\''); rs_newline();
+            journal_frame_flush(&(task->frame));
+            daq_channels_free(task->frame.state, task->mask);
+            fat_file_close(&(task->csv));
+            task->mask = 0;
+        }
+    }
+
+    // wyzwalacze rejestracji zdarze (po obsudze zada - nowe zadanie zacznie prbkowa od kolejnego okresu)
+    daq_trigger_pooling();
+}
+
+unsigned char daq_trigger_set(unsigned char n, char* def) {
+
+    daq_trigger trig;
+    unsigned char len;
+    char* pos = def;
+
+    if (n >= DAQ_TRIGGERS_MAX) {
+        return 0;
+    }
+
+    // pusta definicja - wycz wyzwalacz
+    if ( !def || !*def ) {
+        daq_triggers[n].source = DAQ_TRIGGER_OFF;
+        return 1;
+    }
+
+    memset((void*)&trig, 0, sizeof(daq_trigger));
+
+    // <d|a><kana>,<a|b|r|f>,<prg>,<przed>,<po>,<interwa>,<nazwa>
+    trig.source = *pos;
+    trig.ch     = atoi(pos+1);
+
+    if ( !(pos = strchr(pos, ',')) ) return 0;
+    trig.type   = *(++pos);
+
+    if ( !(pos = strchr(pos, ',')) ) return 0;
+    trig.level  = atoi(++pos);
+
+    if ( !(pos = strchr(pos, ',')) ) return 0;
+    trig.pre    = atoi(++pos);
+
+    if ( !(pos = strchr(pos, ',')) ) return 0;
+    trig.post   = atoi(++pos);
+
+    if ( !(pos = strchr(pos, ',')) ) return 0;
+    trig.interval = atoi(++pos);
+
+    if ( !(pos = strchr(pos, ',')) ) return 0;
+    pos++;
+
+    // nazwa (do 6 znakw: litery, cyfry) - dwa ostatnie znaki nazwy pliku to numer zdarzenia
+    for (len = 0; len < 6; len++) {
+        if ( !((pos[len] >= 'a' && pos[len] <= 'z') || (pos[len] >= 'A' && pos[len] <= 'Z') || (pos[len] >= '0' && pos[len] <= '9')) ) {
+            break;
+        }
+
+        trig.name[len] = pos[len];
+    }
+    trig.name[len] = 0;
+
+    // sprawdzenie poprawnoci definicji
+    if ( !len || (trig.post == 0) ) {
+        return 0;
+    }
+
+    if ( (trig.type != DAQ_TRIGGER_ABOVE) && (trig.type != DAQ_TRIGGER_BELOW) && (trig.type != DAQ_TRIGGER_RISE) && (trig.type != DAQ_TRIGGER_FALL) ) {
+        return 0;
+    }
+
+    if (trig.source == DAQ_TRIGGER_DS) {
+        // okno zdarzenia zapisywane jako zadanie DAQ
+        if ( (trig.ch >= ds_devices_count) || (trig.pre >= DAQ_TRIGGER_PRE_MAX) || (trig.interval < 1) || (trig.interval > 3600) || (trig.pre + 1 + trig.post > 200) ) {
+            return 0;
+        }
+    }
+    else if (trig.source == DAQ_TRIGGER_ADC) {
+        // <po> - liczba blokw zapisywanych za blokiem z wyzwoleniem
+        if (trig.ch >= ADC_SCAN_MAX) {
+            return 0;
+        }
+    }
+    else {
+        return 0;
+    }
+
+    // zmiana definicji w trakcie rejestracji - nie wyzwalaj ponownie przed ustpieniem warunku
+    trig.state = (daq_triggers[n].state == DAQ_TRIGGER_ARMED) ? DAQ_TRIGGER_ARMED : DAQ_TRIGGER_HOLD;
+    trig.task  = daq_triggers[n].task;
+
+    memcpy((void*)&daq_triggers[n], (void*)&trig, sizeof(daq_trigger));
+
+    return 1;
+}
+
+void daq_trigger_pooling() {
+
+    signed int values[DS_DEVICES_MAX];
+    signed int value;
+    unsigned char t, i, n;
+    unsigned long now;
+    char name[9];
+    time_t time;
+
+    daq_trigger* trig;
+    daq_task* task;
+
+    for (t = 0; t < DAQ_TRIGGERS_MAX; t++) {
+        trig = &daq_triggers[t];
+
+        if ( (trig->source != DAQ_TRIGGER_DS) || (++trig->counter < trig->interval) ) {
+            continue;
+        }
+
+        trig->counter = 0;
+
+        // prbka do bufora (nadpisuje najstarsz)
+        value = ds_temp[trig->ch];
+
+        trig->ring[trig->pos] = value;
+        trig->pos = (trig->pos + 1) % DAQ_TRIGGER_PRE_MAX;
+
+        if (trig->count < DAQ_TRIGGER_PRE_MAX) {
+            trig->count++;
+        }
+
+        // zakoczono rejestracj zdarzenia
+        if ( (trig->state == DAQ_TRIGGER_FIRED) && (daq_tasks[trig->task].samples == 0) ) {
+            trig->state = DAQ_TRIGGER_HOLD;
+        }
+
+        if ( !daq_trigger_check(trig, value) ) {
+            // warunek ustpi - uzbrj ponownie
+            if (trig->state == DAQ_TRIGGER_HOLD) {
+                trig->state = DAQ_TRIGGER_ARMED;
+            }
+            continue;
+        }
+
+        if (trig->state != DAQ_TRIGGER_ARMED) {
+            continue;
+        }
+
+        // okno zdarzenia: <pre> prbek z bufora, prbka wyzwalajca i <post> kolejnych
+        n = (trig->count < trig->pre + 1) ? trig->count : trig->pre + 1;
+
+        daq_trigger_name(trig, name);
+
+        if ( !(task = daq_task_start(name, 1 << trig->ch, trig->interval, n + trig->post)) ) {
+            // plik o tej nazwie ju istnieje (np. po restarcie) lub brak wolnego zadania - kolejna prba z now nazw
+            trig->events++;
+            continue;
+        }
+
+        trig->state = DAQ_TRIGGER_FIRED;
+        trig->task  = task - daq_tasks;
+        trig->events++;
+
+        // przepisz bufor do zadania - czas prbek liczony wstecz od biecej
+        ds1306_time_get(&time);
+        now = mktime(&time);
+
+        memset((void*)values, 0, sizeof(values));
+
+        for (i = 0; i < n; i++) {
+            values[trig->ch] = trig->ring[(trig->pos + DAQ_TRIGGER_PRE_MAX - n + i) % DAQ_TRIGGER_PRE_MAX];
+
+            journal_frame_add_at(&(task->frame), values, now - (unsigned long)(n - 1 - i) * trig->interval);
+
+            if (task->csv.name[0]) {
+                gmtime(now - (unsigned long)(n - 1 - i) * trig->interval, &time);
+                daq_csv_write(&(task->csv), task->mask, values, &time);
+            }
+
+            task->samples--;
+        }
+
+        rs_text_P(PSTR("DAQ: wyzwalacz #")); rs_int(t); rs_newline();
+    }
+}
+
+void daq_trigger_adc(unsigned int* block) {
+
+    unsigned char t, i;
+    char name[9];
+
+    daq_trigger* trig;
+
+    for (t = 0; t < DAQ_TRIGGERS_MAX; t++) {
+        trig = &daq_triggers[t];
+
+        if (trig->source != DAQ_TRIGGER_ADC) {
+            continue;
+        }
+
+        // zakoczono zapis blokw zdarzenia
+        if ( (trig->state == DAQ_TRIGGER_FIRED) && (adc_file_blocks == 0) ) {
+            trig->state = DAQ_TRIGGER_HOLD;
+        }
+
+        for (i = 0; i < adc_block_len; i++) {
+
+            if (ADC_SAMPLE_POS(block[i]) != trig->ch) {
+                continue;
+            }
+
+            // poprzednia prbka dostpna dla warunkw przyrostu
+            if (trig->count < 2) {
+                trig->count++;
+            }
+
+            if ( !daq_trigger_check(trig, ADC_SAMPLE_VALUE(block[i])) ) {
+                if (trig->state == DAQ_TRIGGER_HOLD) {
+                    trig->state = DAQ_TRIGGER_ARMED;
+                }
+                continue;
+            }
+
+            if (trig->state != DAQ_TRIGGER_ARMED) {
+                continue;
+            }
+
+            // zapisz biecy blok (prbki sprzed wyzwolenia) i <post> kolejnych
+            daq_trigger_name(trig, name);
+
+            if ( adc_record(name, trig->post + 1) ) {
+                trig->state = DAQ_TRIGGER_FIRED;
+                trig->events++;
+
+                rs_text_P(PSTR("ADC: wyzwalacz #")); rs_int(t); rs_newline();
+            }
+        }
+    }
+}
+
+unsigned char daq_trigger_check(daq_trigger* trig, signed int value) {
+
+    unsigned char result = 0;
+
+    switch (trig->type) {
+        case DAQ_TRIGGER_ABOVE:
+            result = (value > trig->level);
+            break;
+
+        case DAQ_TRIGGER_BELOW:
+            result = (value < trig->level);
+            break;
+
+        case DAQ_TRIGGER_RISE:
+            result = (trig->count > 1) && (value - trig->last >= trig->level);
+            break;
+
+        case DAQ_TRIGGER_FALL:
+            result = (trig->count > 1) && (trig->last - value >= trig->level);
+            break;
+    }
+
+    trig->last = value;
+
+    return result;
+}
+
+void daq_trigger_name(daq_trigger* trig, char* name) {
+
+    unsigned char len = strlen(trig->name);
+
+    memcpy((void*)name, (void*)trig->name, len);
+
+    name[len++] = '0' + (trig->events / 10) % 10;
+    name[len++] = '0' + trig->events % 10;
+    name[len]   = 0;
+}
+
+unsigned char daq_tasks_running() {
+
+    unsigned char t, count = 0;
+
+    for (t = 0; t < DAQ_TASKS_MAX; t++) {
+        if (daq_tasks[t].samples > 0) {
+            count++;
+        }
+    }
 
-    // dokonaj odczytu z kanau <ch>
-    signed int readout = ds_temp[daq_task.ch];
+    return count;
+}
+
+unsigned int daq_samples_left() {
+
+    unsigned char t;
+    unsigned int samples = 0;
+
+    for (t = 0; t < DAQ_TASKS_MAX; t++) {
+        samples += daq_tasks[t].samples;
+    }
+
+    return samples;
+}
+
+void daq_cursor_init(journal_cursor* cur, daq_header* header, unsigned char ch) {
+
+    // domylnie pierwszy kana zadania
+    if ( (ch >= DS_DEVICES_MAX) || !(header->mask & (1 << ch)) ) {
+        for (ch = 0; (ch < DS_DEVICES_MAX - 1) && !(header->mask & (1 << ch)); ch++);
+    }
 
-    // debug
-    rs_send('D'); rs_int(readout); rs_newline();
+    journal_cursor_init(cur, header->seq, ch);
 
-    // zapisz do pliku
-    fs_write(&(daq_task.fp), (unsigned char*)&readout, sizeof(signed int));
+    // pomi ramki innych zada zapisywane rwnolegle do dziennika
+    cur->mask     = header->mask;
+    cur->interval = header->interval;
+}
+
+// dopisz wiersz "RRRR-MM-DD GG:MM:SS;temperatura;temperatura..." do pliku CSV
+unsigned char daq_csv_write(fat_file* fp, unsigned char mask, signed int* values, time_t* time) {
+
+    char row[20 + DS_DEVICES_MAX*7];
+    unsigned char len = 0, ch;
+    signed int value;
+
+    // data
+    row[len++] = '2'; row[len++] = '0';
+    row[len++] = '0' + time->tm_year / 10; row[len++] = '0' + time->tm_year % 10; row[len++] = '-';
+    row[len++] = '0' + time->tm_mon / 10;  row[len++] = '0' + time->tm_mon % 10;  row[len++] = '-';
+    row[len++] = '0' + time->tm_mday / 10; row[len++] = '0' + time->tm_mday % 10; row[len++] = ' ';
+
+    // czas
+    row[len++] = '0' + time->tm_hour / 10; row[len++] = '0' + time->tm_hour % 10; row[len++] = ':';
+    row[len++] = '0' + time->tm_min / 10;  row[len++] = '0' + time->tm_min % 10;  row[len++] = ':';
+    row[len++] = '0' + time->tm_sec / 10;  row[len++] = '0' + time->tm_sec % 10;
 
-    daq_interval = 0;
-    daq_task.samples--;
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
 
-    // zakoczono zadanie
-    if (daq_task.samples == 0) {
-        rs_text_P(PSTR("DAQ: zakonczono rejestracje do pliku '")); rs_text((char*)(daq_task.fp.name)); rs_send('\''); rs_newline();
-        fs_close(&(daq_task.fp));
+        if ( !(mask & (1 << ch)) ) {
+            continue;
+        }
+
+        row[len++] = ';';
+
+        // temperatura (warto 227 odpowiada 22.7C)
+        value = values[ch];
+
+        if (value < 0) {
+            row[len++] = '-';
+            value = -value;
+        }
+        itoa(value / 10, row+len, 10); len = strlen(row);
+        row[len++] = ',';
+        row[len++] = '0' + (value % 10);
     }
+
+    row[len++] = '\r';
+    row[len++] = '\n';
+
+    return fat_file_write(fp, (unsigned char*)row, len) == len;
 }
@@ -10,35 +10,205 @@
 #define DAQ_CMD_COUNT_SENSORS       'c'
 
 #define DAQ_CMD_READ                'r'
-#define DAQ_CMD_READ_SET_POINTS     's'
+#define DAQ_CMD_READ_SET_POINTS     's'     // wartoci zadane stref PID (PID_COUNT x int16)
 #define DAQ_CMD_READ_TEMPERATURE    't'
 #define DAQ_CMD_READ_PWM_FILL       'f'
-#define DAQ_CMD_READ_PID_OUTPUT     'p'
+#define DAQ_CMD_READ_PID_OUTPUT     'p'     // stan stref PID (PID_COUNT x daq_pid_record)
+#define DAQ_CMD_READ_PID_TUNE       'n'     // stan strojenia (daq_tune_record)
+#define DAQ_CMD_READ_DATA           'd'     // rd<nazwa>[,<od ktrej prbki>[,<kana>]]
+
+#define DAQ_CMD_READ_SERIES         'w'     // rw<kana>,<od>,<do> - prbki z zakresu czasu
+#define DAQ_CMD_READ_ADC            'a'     // ostatni peny blok prbek ADC (po decymacji, z pozycj kanau na licie)
+#define DAQ_CMD_READ_SNAPSHOT       'x'     // rx[<maska pl>] - migawka stanu w jednym pakiecie (ukad binarny poniej)
+
+// maksymalna liczba prbek w odpowiedzi na DAQ_CMD_READ_DATA (bufor pakietu przed buforami FAT/FS)
+#define DAQ_READ_DATA_MAX           200
+
+// maksymalna liczba par (czas, prbka) w odpowiedzi na DAQ_CMD_READ_SERIES
+#define DAQ_READ_SERIES_MAX         64
 
 #define DAQ_CMD_SET                 's'
 #define DAQ_CMD_SET_PWM_FILL        'f'
+#define DAQ_CMD_SET_ADC             'a'     // sa<f|czstotliwo>,<kanay np. 0167> / sa0 - stop
+#define DAQ_CMD_SET_ADC_RECORD      'w'     // sw<nazwa>,<liczba blokw> - zapis blokw ADC do pliku FAT
+#define DAQ_CMD_SET_TRIGGER         't'     // st<nr>,<d|a><kana>,<a|b|r|f>,<prg>,<przed>,<po>,<interwa>,<nazwa> / st<nr> - wycz
+#define DAQ_CMD_SET_PWM_BATCH       'b'     // sb<wyp. kanau 0>,<wyp. kanau 1>,... - puste pole pomija kana
+#define DAQ_CMD_SET_PID             'p'     // sp<nr>,<kana ds>,<kana pwm>,<warto zadana>[,<P>,<I>,<D>] / sp<nr> - wycz stref
+#define DAQ_CMD_SET_PID_TUNE        'n'     // sn<nr>,<z|t>,<wypenienie>,<histereza> - strojenie strefy / sn - przerwij
+
+// stan strefy PID (little endian, czasy w us)
+typedef struct {
+    unsigned char sensor;       // kana DS18B20 (0xff - strefa wyczona)
+    unsigned char pwm;          // kana PWM
+    signed int    sp;           // warto zadana (0,1 st. C)
+    unsigned int  gains[3];     // P, I, D (x PID_SCALING_FACTOR)
+    signed int    output;       // ostatnie wyjcie regulatora
+    unsigned int  exec;         // czas wykonania ostatniego przebiegu
+    unsigned int  exec_max;
+    unsigned int  jitter;       // odchyka odstpu midzy przebiegami od okresu prbkowania czujnika
+    unsigned int  jitter_max;
+} daq_pid_record; /* 22 */
+
+// stan strojenia przekanikowego
+typedef struct {
+    unsigned char zone;         // strojona strefa (0xff - brak)
+    unsigned char state;        // PID_TUNE_*
+    unsigned char rule;         // regua doboru nastaw (z / t)
+    unsigned char cycles;       // zarejestrowane okresy oscylacji
+    unsigned int  ku;           // wzmocnienie krytyczne (x PID_SCALING_FACTOR)
+    unsigned long tu;           // okres oscylacji (ms)
+} daq_tune_record; /* 10 */
+
+// migawka stanu (little endian): nagwek daq_snapshot_header, a za nim pola z maski w kolejnoci bitw
+#define DAQ_SNAPSHOT_VERSION        1
+
+#define DAQ_SNAPSHOT_TEMPERATURE    0x01    // DS_DEVICES_MAX x int16 (0,1 st. C)
+#define DAQ_SNAPSHOT_PWM_FILL       0x02    // PWM_CHANNELS x uint8
+#define DAQ_SNAPSHOT_PID_OUTPUT     0x04    // PID_COUNT x int16
+#define DAQ_SNAPSHOT_SET_POINTS     0x08    // PID_COUNT x int16
+#define DAQ_SNAPSHOT_ADC            0x10    // 8 x uint16 - ostatnia prbka wej ADC0..7 (0 - wejcie nieskanowane)
+#define DAQ_SNAPSHOT_ALL            0x1f
+
+// znaczniki stanu w nagwku migawki
+#define DAQ_SNAPSHOT_FLAG_ADC       0x01    // trwa akwizycja ADC
+#define DAQ_SNAPSHOT_FLAG_DAQ       0x02    // trwa zadanie akwizycji
+#define DAQ_SNAPSHOT_FLAG_FAT       0x04    // zamontowana partycja FAT16
+#define DAQ_SNAPSHOT_FLAG_TRIGGER   0x08    // trwa rejestracja zdarzenia
+
+typedef struct {
+    unsigned char version;
+    unsigned char fields;       // maska pl faktycznie zawartych w odpowiedzi
+    unsigned int  seq;          // numer migawki
+    unsigned long uptime;       // s
+    unsigned long time;         // czas z RTC (jak w FS)
+    unsigned char flags;
+    unsigned char ds_count;     // liczba wykrytych czujnikw DS18B20
+} daq_snapshot_header; /* 14 */
+
+// numer kolejnej migawki
+unsigned int daq_snapshot_seq;
 
 unsigned int daq_handle_packet(unsigned char*);
 
 unsigned int daq_read_temperature(unsigned char*);
+unsigned int daq_read_data(unsigned char*);
+unsigned int daq_read_series(unsigned char*);
+unsigned int daq_read_adc(unsigned char*);
+unsigned int daq_read_snapshot(unsigned char*);
+unsigned int daq_read_pid(unsigned char*);
+
+// ustaw wypenienia kilku kanaw PWM jednym poleceniem
+unsigned char daq_set_pwm_batch(unsigned char*);
+
+// sterowanie akwizycj z przetwornika ADC
+unsigned char daq_set_adc(unsigned char*);
 //unsigned int daq_read_pwm(unsigned char*);
 
-// start akwizycji
+// opis zadania zapisywany w pliku FS (same prbki trafiaj do dziennika pomiarw)
+typedef struct {
+    unsigned long seq;          // numer sekwencyjny pierwszego rekordu zadania w dzienniku
+    unsigned char mask;         // maska rejestrowanych kanaw
+    unsigned int  interval;     // okres prbkowania (s)
+    unsigned int  samples;      // liczba zaplanowanych prbek
+} daq_header;
+
+// zadanie akwizycji
+//
+// kade zadanie koduje wszystkie kanay swojej maski we wasnej ramce dziennika - zadania maj
+// niezalene okresy i fazy prbkowania, wic wsplny rekord na takt nie miaby staego odstpu prbek;
+// liczba zapisw zaley gwnie od cznej liczby prbek kanaw (prbka to kilka bitw ramki),
+// a osobne zadania dokadaj jedynie nagwki swoich ramek
+//
+typedef struct {
+    unsigned char mask;         // maska rejestrowanych kanaw (0 - wolne miejsce w tablicy)
+    unsigned int interval;
+    unsigned int samples;       // pozostao prbek do zebrania
+    unsigned int counter;       // licznik sekund w okresie akwizycji
+    unsigned char name[9];      // nazwa pliku FS z opisem zadania
+    journal_frame frame;        // koder prbek zapisywanych do dziennika
+    fat_file csv;               // kopia wynikw w pliku <name>.csv (o ile karta ma partycj FAT16)
+} daq_task;
+
+// tablica rwnolegych zada akwizycji
+daq_task daq_tasks[DAQ_TASKS_MAX];
+
+// stan koderw ramek zada (warto i przyrost na kana) - kade zadanie zajmuje cigy fragment
+// wielkoci swojej maski, zajte kanay oznaczone bitami daq_channels_used
+signed int daq_channels[DAQ_CHANNELS_MAX][2];
+unsigned int daq_channels_used;
+
+// rdo wyzwalacza
+#define DAQ_TRIGGER_OFF         0
+#define DAQ_TRIGGER_DS          'd'     // temperatura z kanau ds_temp[]
+#define DAQ_TRIGGER_ADC         'a'     // prbka ADC (po decymacji) z pozycji listy skanowania
+
+// warunek wyzwolenia
+#define DAQ_TRIGGER_ABOVE       'a'     // warto > prg
+#define DAQ_TRIGGER_BELOW       'b'     // warto < prg
+#define DAQ_TRIGGER_RISE        'r'     // przyrost midzy kolejnymi prbkami >= prg
+#define DAQ_TRIGGER_FALL        'f'     // spadek midzy kolejnymi prbkami >= prg
+
+// stan wyzwalacza
+#define DAQ_TRIGGER_ARMED       0
+#define DAQ_TRIGGER_FIRED       1       // trwa rejestracja zdarzenia
+#define DAQ_TRIGGER_HOLD        2       // czeka na ustpienie warunku
+
+// rejestracja zdarze: bufor ostatnich prbek + zapis okna wok wyzwolenia
+typedef struct {
+    unsigned char source;
+    unsigned char ch;
+    unsigned char type;
+    signed int    level;
+    unsigned char pre;          // prbek sprzed wyzwolenia (ADC: biecy blok)
+    unsigned int  post;         // prbek po wyzwoleniu (ADC: blokw)
+    unsigned int  interval;     // okres prbkowania (s) - tylko DAQ_TRIGGER_DS
+    char          name[7];      // nazwa pliku (uzupeniana numerem zdarzenia)
+
+    unsigned char state;
+    unsigned char events;       // liczba zarejestrowanych zdarze
+    unsigned char task;         // zadanie DAQ rejestrujce zdarzenie
+    unsigned int  counter;      // licznik sekund w okresie prbkowania
+    signed int    last;         // poprzednia prbka (warunki przyrostu)
+    unsigned char count;        // liczba prbek w buforze
+    unsigned char pos;          // pozycja zapisu w buforze
+    signed int    ring[DAQ_TRIGGER_PRE_MAX];
+} daq_trigger;
+
+daq_trigger daq_triggers[DAQ_TRIGGERS_MAX];
+
+// start akwizycji (nazwa, maska kanaw, interwa, liczba prbek) - odrzucany, gdy trwa
+// zadanie o tej samej masce i interwale
 unsigned int daq_start(char*, unsigned char, unsigned int, unsigned int);
+daq_task* daq_task_start(char*, unsigned char, unsigned int, unsigned int);
+
+// przydziel / zwolnij stan kodera ramek dla kanaw z maski (0 - brak miejsca)
+signed int* daq_channels_alloc(unsigned char);
+void daq_channels_free(signed int*, unsigned char);
+
+// ustaw wyzwalacz <nr> wg definicji "<d|a><kana>,<a|b|r|f>,<prg>,<przed>,<po>,<interwa>,<nazwa>" (pusta - wycz)
+unsigned char daq_trigger_set(unsigned char, char*);
+
+// sprawd wyzwalacze temperatur (co sekund) / prbek ADC (peny blok)
+void daq_trigger_pooling();
+void daq_trigger_adc(unsigned int*);
+
+// sprawd warunek wyzwalacza dla kolejnej prbki
+unsigned char daq_trigger_check(daq_trigger*, signed int);
+
+// nazwa pliku zdarzenia: <nazwa><nr zdarzenia>
+void daq_trigger_name(daq_trigger*, char*);
 
 // prbuj dokona akwizycji co sekund
 void daq_pooling();
 
-// zadanie akwizycji
-struct {
-    char name[9];
-    unsigned char ch;
-    unsigned int interval;
-    unsigned int samples;
-    fs_file fp;
-} daq_task;
+// liczba trwajcych zada / pozostaych do zebrania prbek (wszystkich zada)
+unsigned char daq_tasks_running();
+unsigned int daq_samples_left();
+
+// ustaw dekoder na prbki kanau zapisane przez zadanie (kana 0xFF - pierwszy kana z maski)
+void daq_cursor_init(journal_cursor*, daq_header*, unsigned char);
 
-// licznik sekund w okresie akwizycji
-unsigned int daq_interval;
+// dopisz wiersz pomiarw kanaw z maski (data i czas z RTC) do pliku CSV na partycji FAT
+unsigned char daq_csv_write(fat_file*, unsigned char, signed int*, time_t*);
 
 #endif
@@ -1,47 +1,132 @@
 #include "ds18b20.h"
 
 // detekcja czujnikow temperatury ds18b20 (family code = 0x28)
-unsigned char ds_devices[DS_DEVICES_MAX][8];    // kody ROM czujnikw
-unsigned char ds_devices_count;                 // liczba wykrytych czujnikw 1wire
+unsigned char ds_devices_count;                 // liczba kanaw z przypisanymi czujnikami 1wire
+volatile unsigned char ds_present;              // kanay z podczonym czujnikiem
 volatile signed int ds_temp[DS_DEVICES_MAX];    // tablica na aktualnie zmierzone temperatury (gdzie wartosc 227 odpowiada 22.7C)
+unsigned char ds_bus[DS_DEVICES_MAX];           // magistrala 1wire czujnika
+volatile unsigned char ds_cycle_ch[OW_BUSES];   // kanay odczytywane w tle (po jednym na magistral)
+unsigned char ds_res[DS_DEVICES_MAX];           // rozdzielczo pomiaru kanau
+unsigned int  ds_countdown[DS_DEVICES_MAX];     // takty poolingu do kolejnego pomiaru kanau
+volatile unsigned char ds_cycle_state;
+volatile unsigned char ds_measuring;            // kanay w trakcie pomiaru (polecenie wysane, wynik nieodczytany)
+volatile unsigned char ds_due;                  // kanay z progami w biecym przeszukiwaniu Alarm Search
+volatile unsigned char ds_pending;              // kanay z progami do odczytu (zgoszony alarm)
+volatile unsigned char ds_round;                // magistrale biecej transakcji
+volatile unsigned char ds_alarm;                // kanay z alarmem w ostatnim przeszukiwaniu
+volatile unsigned char ds_alarm_report;         // kanay, ktre weszy w alarm (do zgoszenia w ptli gwnej)
+volatile unsigned char ds_attach_report;        // kanay z doczonym czujnikiem (do zgoszenia w ptli gwnej)
+volatile unsigned char ds_detach_report;        // kanay z odczonym czujnikiem (do zgoszenia w ptli gwnej)
+volatile unsigned char ds_alarm_bus;            // przeszukiwana magistrala
+unsigned char ds_alarm_cycles;                  // przeszukiwania od ostatniego penego odczytu
+unsigned char ds_resolution;                    // maksymalna rozdzielczo (z ds18b20_init)
+unsigned int  ds_discover_countdown;            // takty poolingu do kolejnego przeszukiwania
+volatile unsigned char ds_discover_seen;        // kanay czujnikw znalezionych w biecym przeszukiwaniu
+volatile unsigned char ds_discover_missing;     // kanay czujnikw nieznalezionych w poprzednim przeszukiwaniu
+volatile unsigned char ds_discover_bus;
+volatile unsigned char ds_discover_pass;
+volatile unsigned char ds_discover_new;
+volatile unsigned char ds_discover_setup;
 
 void ds18b20_init(unsigned char resolution) {
+
+    unsigned char bus, ch, pass;
     
+    ds_resolution    = resolution;
     ds_devices_count = 0;
+    ds_present       = 0;
+
+    // kanay z przypisanymi (w konfiguracji) czujnikami
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+        if (ds_devices[ch][0]) {
+            ds_devices_count = ch + 1;
+        }
+    }
+
+    ds_discover_seen = 0;
+    ds_discover_new  = 0;
 
-    // detekcja slave'ow na 1wire
-    if (ow_first_search() == 1) {
-        do {
-            unsigned char b;
+    // detekcja slave'ow na kolejnych magistralach 1wire - najpierw czujniki z przypisanymi
+    // kanaami, w drugim przejciu (o ile s) nowe czujniki
+    for (pass = 0; pass < 2; pass++) {
+        for (bus = 0; bus < OW_BUSES; bus++) {
+            ow_select_bus(bus);
 
-            // dopisz do listy czujnikow ds18b20
-            if ( (OW_ROM[0] == 0x28) && (ds_devices_count < DS_DEVICES_MAX) ) {
-                for (b=0; b<8; b++) {
-                    ds_devices[ds_devices_count][b] = OW_ROM[b];
-                    ds_temp[ds_devices_count] = 0;
-                }
+            if (ow_first_search() == 1) {
+                do {
+                    ch = ds18b20_bind(OW_ROM, bus, pass);
 
-                ds_devices_count++; // zwieksz licznik liczby czujnikow ds18b20
+                    if (ch != DS_CHANNEL_NONE) {
+                        ds_discover_seen |= 1 << ch;
+                    }
+                    else if (OW_ROM[0] == 0x28) {
+                        ds_discover_new = 1;
+                    }
+
+                } while (ow_next_search() == 1);
             }
+        }
+
+        if (!ds_discover_new) {
+            break;
+        }
+    }
+
+    ds_present          = ds_discover_seen;
+    ds_discover_missing = 0;
 
-        } while (ow_next_search() == 1);
+    // rozdzielczo pomiaru kadego kanau wg wymaganego okresu prbkowania (nie wysza ni podana)
+    for (ch = 0; ch < ds_devices_count; ch++) {
+        ds18b20_channel_init(ch);
 
-        // ustaw rozdzielczosc pomiaru temperatur i zazadaj pierwszego pomiaru
-        //ds18b20_set_resolution(DS18B20_RESOLUTION_11_BITS); // 0.125C
-        //ds18b20_set_resolution(DS18B20_RESOLUTION_12_BITS); // 0.0625C
-        ds18b20_set_resolution(resolution);
-        ds18b20_request_measure();
+        ds_temp[ch] = 0;
+
+        if ( !(ds_present & (1 << ch)) ) {
+            continue;
+        }
+
+        ow_select_bus( ds_bus[ch] );
+
+        // progi alarmowe kanau zapisywane razem z rozdzielczoci
+        if ( ds18b20_alarm_mode(ch) ) {
+            ds18b20_set_triggers(ds_devices[ch], my_config.ds_alarm_low[ch], my_config.ds_alarm_high[ch], ds_res[ch]);
+        }
+        else {
+            ds18b20_set_resolution(ds_devices[ch], ds_res[ch]);
+        }
     }
+
+    ds_discover_countdown = DS_DISCOVER_PERIOD;
+    ds_discover_setup     = DS_CHANNEL_NONE;
+
+    ds_cycle_state  = DS_CYCLE_IDLE;
+    ds_measuring    = 0;
+    ds_pending      = 0;
+    ds_alarm        = 0;
+    ds_alarm_report = 0;
+    ds_alarm_cycles = 0;
+
+    ds_attach_report = 0;
+    ds_detach_report = 0;
+
+    // zazadaj pierwszego pomiaru
+    ds18b20_request_measure();
 }
 
-// wysya wszystkim czujnikom na magistrali 1wire
+// wysya wszystkim czujnikom na magistralach 1wire
 // zadanie dokonania pomiaru temperatury i zapisu
 // wyniku w pamieci Scrachpad
 void ds18b20_request_measure()
 {
-    ow_reset();
-    ow_write(0xcc); // skip ROM (zadanie do wszystkich)
-    ow_write(0x44); // pomiar
+    unsigned char bus;
+
+    for (bus = 0; bus < OW_BUSES; bus++) {
+        ow_select_bus(bus);
+
+        ow_reset();
+        ow_write(0xcc); // skip ROM (zadanie do wszystkich)
+        ow_write(0x44); // pomiar
+    }
 
     return;
 }
@@ -55,7 +140,6 @@ void ds18b20_request_measure()
 signed int ds18b20_get_temperature(unsigned char* dev)
 {
     unsigned int tmp;   // zmienna pomocnicza przy odczycie rejestrow ds18b20
-    signed int temp;   // temperatura
 
     ow_reset();
 
@@ -68,6 +152,14 @@ signed int ds18b20_get_temperature(unsigned char* dev)
 
     ow_reset(); // odczytalismy juz potrzebne dane (niech ds18b20 nie przesyla wiecej danych)
 
+    return ds18b20_convert(tmp);
+}
+
+// przelicz odczyt rejestru temperatury
+signed int ds18b20_convert(unsigned int tmp)
+{
+    signed int temp;   // temperatura
+
     // bd na szynie
     if ( (tmp == 0xffff) || (tmp == 0x0000) ) {
         return 2000;
@@ -116,22 +208,22 @@ void ds18b20_get_temperature_from_all()
 {
     signed int tmp;
 
-    // przypisania kanaw do kolejnych czujnikw DS18B20 na szynie 1wire
-    //
-    //
-    // !!! Identyfikacja konieczna po kadej zmianie lub dodaniu czujnikw !!!
-    //
-    //
-    // np. czujnik wykryty jako drugi na szynie 1wire przypisany do kanau #4
-    //     czujnik wykryty jako trzeci na szynie 1wire przypisany do kanau #2
-    //     ...
+    // przypisania kanaw do czujnikw DS18B20 wg kodw ROM (my_config.ds_rom)
     //
-    // #define DS_ASSIGNMENT   {1,4,2,0,3}
+    // czujnik znaleziony na magistrali po raz pierwszy zajmuje kana czujnika, ktrego
+    // nie ma ju na magistralach (wymiana sondy), a gdy takiego brak - pierwszy wolny kana;
+    // kolejno kanaw mona zmieni w menu konfiguracji (zamiana kanaw)
 
     // odczyt temperatury z kolejnych czujnikow
     // temperatura 25.3 zostanie zapisana jako wartosci 253
     for (unsigned int dev=0; dev<ds_devices_count; dev++) {
-        tmp = ds18b20_get_temperature(ds_devices[ my_config.ds_assignment[dev] ]);
+        if ( !(ds_present & (1 << dev)) ) {
+            continue;
+        }
+
+        ow_select_bus( ds_bus[dev] );
+
+        tmp = ds18b20_get_temperature(ds_devices[dev]);
     
         if (tmp != 2000)
             ds_temp[dev] = tmp;
@@ -139,35 +231,526 @@ void ds18b20_get_temperature_from_all()
 }
 
 
-// ustaw rozdzielczosc pomiaru temperatur
-// wszystkich czujnikow
-void ds18b20_set_resolution(unsigned char res)
+// rozdzielczo pozwalajca zakoczy pomiar w okresie prbkowania (x 100 ms)
+unsigned char ds18b20_resolution_for(unsigned char period)
 {
-    unsigned char conf = 0b00011111;
+    if ( (period == 0) || (period >= 8) ) {
+        return DS18B20_RESOLUTION_12_BITS;  // 750 ms
+    }
 
-    conf |= res << 5;
+    if (period >= 4) {
+        return DS18B20_RESOLUTION_11_BITS;  // 375 ms
+    }
 
-    ow_reset();
+    if (period >= 2) {
+        return DS18B20_RESOLUTION_10_BITS;  // 187,5 ms
+    }
 
-	ow_write(0x4E); // konfiguracja DS18B20
-	ow_write(0x00); // T_l
-	ow_write(0x00); // T_h
-	ow_write(conf); // bajt konfiguracyjny
+    return DS18B20_RESOLUTION_9_BITS;       // 93,75 ms
+}
 
-    ow_reset();
+// co takt poolingu (25 ms): odczytaj kanay z zakoczonym pomiarem, rozpocznij pomiar kanaw,
+// ktrym upyn okres prbkowania
+void ds18b20_pooling()
+{
+    unsigned char ch;
 
-    return;
+    for (ch = 0; ch < ds_devices_count; ch++) {
+        if (ds_countdown[ch]) {
+            ds_countdown[ch]--;
+        }
+    }
+
+    if (ds_discover_countdown) {
+        ds_discover_countdown--;
+    }
+
+    // poprzednia transakcja jeszcze trwa
+    if ( ow_busy() ) {
+        return;
+    }
+
+    // wyszukiwanie czujnikw - kolejna transakcja
+    if (ds_cycle_state == DS_CYCLE_DISCOVER) {
+        ds18b20_discover_next();
+        return;
+    }
+
+    // kolejne transakcje uruchamiane z zakoczenia poprzednich
+    if (ds_cycle_state != DS_CYCLE_IDLE) {
+        return;
+    }
+
+    // kolejne wyszukiwanie doczonych / odczonych czujnikw
+    if (ds_discover_countdown == 0) {
+        ds_discover_countdown = DS_DISCOVER_PERIOD;
+
+        ds_discover_seen = 0;
+        ds_discover_new  = 0;
+        ds_discover_pass = 0;
+        ds_discover_bus  = 0;
+        ds_cycle_state   = DS_CYCLE_DISCOVER;
+
+        ow_search_reset();
+        ds18b20_discover_next();
+        return;
+    }
+
+    ds18b20_cycle_next();
+}
+
+// transakcja kanau na magistrali: match ROM + polecenie
+void ds18b20_cycle_tx(unsigned char bus, unsigned char ch, unsigned char cmd)
+{
+    ds_cycle_ch[bus] = ch;
+    ds_round |= 1 << bus;
+
+    ow_tx[bus][0] = 0x55; // match ROM
+    memcpy((void*)(ow_tx[bus]+1), (void*)ds_devices[ch], 8);
+    ow_tx[bus][9] = cmd;
+}
+
+void ds18b20_cycle_next()
+{
+    unsigned char bus, ch, ready = 0, alarm = 0;
+
+    // kanay, ktrym upyn maksymalny czas pomiaru w ich rozdzielczoci
+    for (ch = 0; ch < ds_devices_count; ch++) {
+        if ( !(ds_measuring & (1 << ch)) ) {
+            continue;
+        }
+
+        // czujnik odczony w trakcie pomiaru
+        if ( !(ds_present & (1 << ch)) ) {
+            ds_measuring &= ~(1 << ch);
+            continue;
+        }
+
+        if (ds18b20_elapsed(ch) < ds18b20_conversion(ch)) {
+            continue;
+        }
+
+        if ( ds18b20_alarm_mode(ch) && !(ds_pending & (1 << ch)) ) {
+            alarm |= 1 << ch;
+        }
+        else {
+            ready |= 1 << ch;
+        }
+    }
+
+    // kanay z progami odczytywane tylko po wykryciu alarmu (co DS_ALARM_REFRESH przeszukiwa wszystkie)
+    if (alarm) {
+        if (++ds_alarm_cycles < DS_ALARM_REFRESH) {
+            ds_due         = alarm;
+            ds_cycle_state = DS_CYCLE_ALARM;
+
+            ds18b20_alarm_next(0);
+            return;
+        }
+
+        ds_alarm_cycles = 0;
+        ready |= alarm;
+    }
+
+    // odczyt - po jednym kanale z kadej magistrali jednoczenie
+    ds_round = 0;
+
+    for (bus = 0; bus < OW_BUSES; bus++) {
+        for (ch = 0; ch < ds_devices_count; ch++) {
+            if ( (ready & (1 << ch)) && (ds_bus[ch] == bus) ) {
+                ds18b20_cycle_tx(bus, ch, 0xbe); // read scratchpad
+                break;
+            }
+        }
+    }
+
+    if (ds_round) {
+        ds_cycle_state = DS_CYCLE_READ;
+        ow_start(ds_round, 10, 2, ds18b20_on_read);
+        return;
+    }
+
+    // pomiar kanaw, ktrym upyn okres prbkowania (poprzedni wynik ju odczytany)
+    for (bus = 0; bus < OW_BUSES; bus++) {
+        for (ch = 0; ch < ds_devices_count; ch++) {
+            if ( (ds_present & (1 << ch)) && !(ds_measuring & (1 << ch)) && (ds_countdown[ch] == 0) && (ds_bus[ch] == bus) ) {
+                ds_countdown[ch] = ds18b20_period(ch);
+                ds18b20_cycle_tx(bus, ch, 0x44); // pomiar
+                break;
+            }
+        }
+    }
+
+    if (ds_round) {
+        ds_cycle_state = DS_CYCLE_CONVERT;
+        ow_start(ds_round, 10, 0, ds18b20_on_measure);
+        return;
+    }
+
+    ds_cycle_state = DS_CYCLE_IDLE;
+}
+
+// kanay rundy odczytane / pominite - koniec pomiaru
+void ds18b20_cycle_done()
+{
+    unsigned char bus;
+
+    for (bus = 0; bus < OW_BUSES; bus++) {
+        if (ds_round & (1 << bus)) {
+            ds_measuring &= ~(1 << ds_cycle_ch[bus]);
+            ds_pending   &= ~(1 << ds_cycle_ch[bus]);
+        }
+    }
+}
+
+// polecenie pomiaru wysane - odczyt po maksymalnym czasie pomiaru kanau
+void ds18b20_on_measure(unsigned char buses)
+{
+    unsigned char bus;
+
+    for (bus = 0; bus < OW_BUSES; bus++) {
+        if (ds_round & (1 << bus)) {
+            ds_measuring |= 1 << ds_cycle_ch[bus];
+        }
+    }
+
+    ds18b20_cycle_next();
+}
+
+// przeszukaj kolejn magistral z kanaami z progami po pomiarze (po wszystkich - odczyt)
+void ds18b20_alarm_next(unsigned char bus)
+{
+    unsigned char ch;
+
+    for (; bus < OW_BUSES; bus++) {
+        for (ch = 0; ch < ds_devices_count; ch++) {
+            if ( (ds_due & (1 << ch)) && (ds_bus[ch] == bus) ) {
+                break;
+            }
+        }
+
+        if (ch == ds_devices_count) {
+            continue;
+        }
+
+        ds_alarm_bus = bus;
+
+        ow_search_reset();
+        ow_start_search(bus, OW_SEARCH_ALARM, ds18b20_on_alarm);
+        return;
+    }
+
+    // koniec przeszukiwania - znalezione kanay czekaj na odczyt (ds_pending), pozostae kocz
+    // pomiar bez odczytu; zgo te, ktre weszy w alarm
+    for (ch = 0; ch < ds_devices_count; ch++) {
+        if ( !(ds_due & (1 << ch)) ) {
+            continue;
+        }
+
+        if (ds_pending & (1 << ch)) {
+            if ( !(ds_alarm & (1 << ch)) ) {
+                ds_alarm_report |= 1 << ch;
+            }
+
+            ds_alarm |= 1 << ch;
+        }
+        else {
+            ds_alarm     &= ~(1 << ch);
+            ds_measuring &= ~(1 << ch);
+        }
+    }
+
+    ds18b20_cycle_next();
+}
+
+// znaleziony czujnik z flag alarmu (lub koniec przeszukiwania magistrali)
+void ds18b20_on_alarm(unsigned char buses)
+{
+    unsigned char ch, bus = ds_alarm_bus;
+
+    // brak (kolejnych) czujnikw z alarmem
+    if (!buses) {
+        ds18b20_alarm_next(bus + 1);
+        return;
+    }
+
+    for (ch = 0; ch < ds_devices_count; ch++) {
+        if ( (ds_due & (1 << ch)) && (ds_bus[ch] == bus) && !memcmp((void*)OW_ROM, (void*)ds_devices[ch], 8) ) {
+            ds_pending |= 1 << ch;
+        }
+    }
+
+    if (LastDeviceFlag) {
+        ds18b20_alarm_next(bus + 1);
+    }
+    else {
+        ow_start_search(bus, OW_SEARCH_ALARM, ds18b20_on_alarm);
+    }
+}
+
+void ds18b20_on_read(unsigned char buses)
+{
+    unsigned char bus, ch, read = 0;
+    signed int tmp;
+
+    for (bus = 0; bus < OW_BUSES; bus++) {
+        if ( !(buses & (1 << bus)) ) {
+            continue;
+        }
+
+        ch = ds_cycle_ch[bus];
+
+        // w niszych rozdzielczociach najmodsze bity rejestru s nieokrelone
+        tmp = ds18b20_convert( (ow_rx[bus][0] | ((unsigned int)ow_rx[bus][1] << 8)) & ~((1 << (DS18B20_RESOLUTION_12_BITS - ds_res[ch])) - 1) );
+
+        if (tmp != 2000) {
+            ds_temp[ch] = tmp;
+            read       |= 1 << ch;
+        }
+    }
+
+    ds18b20_cycle_done();
+
+    // regulatory stref, ktrych czujniki wanie odczytano (bd odczytu - bez nowej wartoci procesowej)
+    pid_on_measure(read);
+
+    ds18b20_cycle_next();
+}
+
+// kana czujnika o podanym kodzie ROM
+unsigned char ds18b20_bind(unsigned char* rom, unsigned char bus, unsigned char add)
+{
+    unsigned char ch, pick = DS_CHANNEL_NONE;
+
+    if (rom[0] != 0x28) {
+        return DS_CHANNEL_NONE;
+    }
+
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+        if ( !memcmp((void*)ds_devices[ch], (void*)rom, 8) ) {
+            ds_bus[ch] = bus;
+            return ch;
+        }
+
+        // kana czujnika nieobecnego na magistralach przed wolnym kanaem
+        if ( !(ds_discover_seen & (1 << ch)) && ( (pick == DS_CHANNEL_NONE) || (ds_devices[ch][0] && !ds_devices[pick][0]) ) ) {
+            pick = ch;
+        }
+    }
+
+    if ( !add || (pick == DS_CHANNEL_NONE) ) {
+        return DS_CHANNEL_NONE;
+    }
+
+    // nowe przypisanie (w przerwaniu / przed wczeniem przerwa - kana nie jest w tym czasie mierzony)
+    memcpy((void*)ds_devices[pick], (void*)rom, 8);
+
+    ds_bus[pick]   = bus;
+    ds_temp[pick]  = 0;
+    ds_present    &= ~(1 << pick);
+    config_changed = 1;
+
+    if (pick >= ds_devices_count) {
+        ds_devices_count = pick + 1;
+    }
+
+    return pick;
+}
+
+void ds18b20_channel_init(unsigned char ch)
+{
+    ds_res[ch] = ds18b20_resolution_for(my_config.ds_period[ch]);
+
+    if (ds_res[ch] > ds_resolution) {
+        ds_res[ch] = ds_resolution;
+    }
+
+    ds_countdown[ch] = 0;
+}
+
+void ds18b20_report()
+{
+    unsigned char ch, alarm, attach, detach, sreg;
+
+    sreg = SREG;
+    cli();
+
+    alarm  = ds_alarm_report;
+    attach = ds_attach_report;
+    detach = ds_detach_report;
+
+    ds_alarm_report  = 0;
+    ds_attach_report = 0;
+    ds_detach_report = 0;
+
+    SREG = sreg;
+
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+        if (attach & (1 << ch)) {
+            rs_text_P(PSTR("DS18B20: dolaczono #")); rs_int(ch); rs_newline();
+        }
+
+        if (detach & (1 << ch)) {
+            rs_text_P(PSTR("DS18B20: odlaczono #")); rs_int(ch); rs_newline();
+        }
+
+        if (alarm & (1 << ch)) {
+            rs_text_P(PSTR("DS18B20: alarm #")); rs_int(ch); rs_newline();
+        }
+    }
+}
+
+void ds18b20_swap(unsigned char a, unsigned char b)
+{
+    unsigned char rom[8], bus, sreg;
+    signed int temp;
+
+    // kody ROM kopiowane s do ow_tx w przerwaniach Timera1
+    sreg = SREG;
+    cli();
+
+    memcpy((void*) rom, (void*) ds_devices[a], 8);
+    memcpy((void*) ds_devices[a], (void*) ds_devices[b], 8);
+    memcpy((void*) ds_devices[b], (void*) rom, 8);
+
+    bus = ds_bus[a];
+    ds_bus[a] = ds_bus[b];
+    ds_bus[b] = bus;
+
+    temp = ds_temp[a];
+    ds_temp[a] = ds_temp[b];
+    ds_temp[b] = temp;
+
+    // bity obecnoci i alarmu zamieniane tylko, gdy si rni
+    if ( !(ds_present & (1 << a)) != !(ds_present & (1 << b)) ) {
+        ds_present ^= (1 << a) | (1 << b);
+    }
+
+    if ( !(ds_alarm & (1 << a)) != !(ds_alarm & (1 << b)) ) {
+        ds_alarm ^= (1 << a) | (1 << b);
+    }
+
+    SREG = sreg;
+
+    config_changed = 1;
+}
+
+// kolejna transakcja wyszukiwania (co takt poolingu)
+void ds18b20_discover_next()
+{
+    // doczony czujnik - najpierw konfiguracja kanau
+    if (ds_discover_setup != DS_CHANNEL_NONE) {
+        ds18b20_setup_start(ds_discover_setup);
+
+        ds_discover_setup = DS_CHANNEL_NONE;
+        return;
+    }
+
+    if (ds_discover_bus < OW_BUSES) {
+        ow_start_search(ds_discover_bus, OW_SEARCH_ROM, ds18b20_on_discover);
+        return;
+    }
+
+    // czujniki bez kanaw: drugie przejcie (znane czujniki s ju oznaczone jako obecne)
+    if ( ds_discover_new && !ds_discover_pass ) {
+        ds_discover_pass = 1;
+        ds_discover_bus  = 0;
+
+        ow_search_reset();
+        return;
+    }
+
+    ds18b20_discover_finish();
+}
+
+// znaleziony czujnik (lub koniec przeszukiwania magistrali)
+void ds18b20_on_discover(unsigned char buses)
+{
+    unsigned char ch;
+
+    if (buses) {
+        ch = ds18b20_bind(OW_ROM, ds_discover_bus, ds_discover_pass);
+
+        if (ch != DS_CHANNEL_NONE) {
+            ds_discover_seen |= 1 << ch;
+
+            // czujnik doczony (ponownie) - po wczeniu zasilania ma ustawienia ze swojej pamici EEPROM
+            if ( !(ds_present & (1 << ch)) ) {
+                ds_present |= 1 << ch;
+                ds18b20_channel_init(ch);
+
+                ds_discover_setup = ch;
+                ds_attach_report |= 1 << ch;
+            }
+        }
+        else if (OW_ROM[0] == 0x28) {
+            ds_discover_new = 1;
+        }
+    }
+
+    if ( !buses || LastDeviceFlag ) {
+        ds_discover_bus++;
+        ow_search_reset();
+    }
+}
+
+// koniec wyszukiwania: czujnik nieznaleziony w dwch kolejnych przeszukiwaniach uznawany za odczony
+void ds18b20_discover_finish()
+{
+    unsigned char gone;
+
+    gone = ds_present & ~ds_discover_seen & ds_discover_missing;
+
+    ds_discover_missing = ds_present & ~ds_discover_seen;
+
+    ds_detach_report |= gone;
+    ds_present       &= ~gone;
+    ds_cycle_state = DS_CYCLE_IDLE;
+}
+
+void ds18b20_setup_start(unsigned char ch)
+{
+    unsigned char bus = ds_bus[ch];
+
+    ow_tx[bus][0] = 0x55; // match ROM
+    memcpy((void*)(ow_tx[bus]+1), (void*)ds_devices[ch], 8);
+    ow_tx[bus][9] = 0x4e; // konfiguracja DS18B20
+
+    if ( ds18b20_alarm_mode(ch) ) {
+        ow_tx[bus][10] = my_config.ds_alarm_high[ch];
+        ow_tx[bus][11] = my_config.ds_alarm_low[ch];
+    }
+    else {
+        ow_tx[bus][10] = 127;
+        ow_tx[bus][11] = -128;
+    }
+
+    ow_tx[bus][12] = 0b00011111 | (ds_res[ch] << 5);
+
+    ow_start(1 << bus, 13, 0, 0);
+}
+
+// ustaw rozdzielczosc pomiaru temperatur
+// podanego czujnika (progi poza zakresem pomiaru - czujnik nie zglasza alarmu)
+void ds18b20_set_resolution(unsigned char* dev, unsigned char res)
+{
+    ds18b20_set_triggers(dev, -128, 127, res);
 }
 
 // ustaw zakresy wyzwalania alarmow podanego czujnika
-void ds18b20_set_triggers(unsigned char* dev, signed char tl, signed char th)
+// (Write Scratchpad wymaga zapisu wszystkich trzech bajtow przed resetem)
+void ds18b20_set_triggers(unsigned char* dev, signed char tl, signed char th, unsigned char res)
 {
-    ow_reset();
+    unsigned char conf = 0b00011111;
+
+    conf |= res << 5;
 
-    ow_match_rom(dev);    
+    ow_match_rom(dev);
 
 	ow_write(0x4E); // konfiguracja DS18B20
-	ow_write(0x00); // T_l
-	ow_write(0x00); // T_h
-    ow_reset();     // nie przesylamy juz bajtu konfiguracyjnego
+	ow_write(th);   // T_h
+	ow_write(tl);   // T_l
+	ow_write(conf); // bajt konfiguracyjny
+
+    ow_reset();
 }
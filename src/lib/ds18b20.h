@@ -3,15 +3,51 @@
 
 #include "../telemetry.h"
 
-extern unsigned char ds_devices[DS_DEVICES_MAX][8]; // kody ROM czujnikw
-extern unsigned char ds_devices_count;              // liczba wykrytych czujnikw 1wire
+#define ds_devices      (my_config.ds_rom)          // kody ROM czujnikw kanaw (przypisania zapisywane w konfiguracji)
+extern unsigned char ds_devices_count;              // liczba kanaw z przypisanymi czujnikami 1wire
+extern volatile unsigned char ds_present;           // kanay z podczonym czujnikiem
 extern volatile signed int ds_temp[DS_DEVICES_MAX]; // tablica na aktualnie zmierzone temperatury (gdzie wartosc 227 odpowiada 22.7C)
 
-// inicjalizacja czujnikow DS18B20 z zadana rozdzielczoscia pomiarow
+// inicjalizacja czujnikow DS18B20 z zadana (maksymalna) rozdzielczoscia pomiarow
 // wykonuje skanowanie magistrali 1wire,
 // konfiguracje czujnikow i odczyt ich kodow ROM
 void ds18b20_init(unsigned char);
 
+// przypisanie kanaw wg kodw ROM: znany czujnik wraca na swj kana, nowy zajmuje kana
+// czujnika nieobecnego w biecym przeszukiwaniu (wymiana sondy) lub pierwszy wolny
+#define DS_CHANNEL_NONE     0xff
+
+// kana czujnika (kod ROM, magistrala, przypisz nowy czujnik) - DS_CHANNEL_NONE: inny ukad / nowy czujnik
+unsigned char ds18b20_bind(unsigned char*, unsigned char, unsigned char);
+
+// rozdzielczo i licznik okresu prbkowania kanau
+void ds18b20_channel_init(unsigned char);
+
+// zamie czujniki kanaw (kody ROM w konfiguracji oraz magistrale, obecno i ostatnie pomiary)
+void ds18b20_swap(unsigned char, unsigned char);
+
+// wyszukiwanie w tle doczonych i odczonych czujnikw: po jednej transakcji (kod ROM /
+// konfiguracja czujnika) na takt poolingu, pomiary wstrzymane do koca przeszukiwania
+#define DS_DISCOVER_PERIOD  400     // takty poolingu midzy przeszukiwaniami (10 s)
+
+extern unsigned char ds_resolution;                 // maksymalna rozdzielczo (z ds18b20_init)
+extern unsigned int  ds_discover_countdown;         // takty poolingu do kolejnego przeszukiwania
+extern volatile unsigned char ds_discover_seen;     // kanay czujnikw znalezionych w biecym przeszukiwaniu
+extern volatile unsigned char ds_discover_missing;  // kanay czujnikw nieznalezionych w poprzednim przeszukiwaniu
+extern volatile unsigned char ds_discover_bus;      // przeszukiwana magistrala
+extern volatile unsigned char ds_discover_pass;     // 0 - czujniki z kanaami / 1 - przypisanie nowych
+extern volatile unsigned char ds_discover_new;      // znaleziono czujnik bez kanau
+extern volatile unsigned char ds_discover_setup;    // kana doczonego czujnika do skonfigurowania
+extern volatile unsigned char ds_attach_report;     // kanay z doczonym / odczonym czujnikiem (do zgoszenia
+extern volatile unsigned char ds_detach_report;     // w ptli gwnej - ds18b20_report())
+
+void ds18b20_discover_next();
+void ds18b20_on_discover(unsigned char);
+void ds18b20_discover_finish();
+
+// zapisz progi i rozdzielczo kanau w czujniku (transakcja w tle)
+void ds18b20_setup_start(unsigned char);
+
 // wysya wszystkim czujnikom na magistrali 1wire
 // zadanie dokonania pomiaru temperatury i zapisu
 // wyniku w pamieci Scrachpad
@@ -25,12 +61,78 @@ signed int ds18b20_get_temperature(unsigned char*);
 // tablicy ds_temp
 void ds18b20_get_temperature_from_all();
 
+// przelicz odczyt rejestru temperatury (2000 - bd na szynie)
+signed int ds18b20_convert(unsigned int);
+
+// pomiary w tle (transakcje 1wire w przerwaniach Timera1): kana, ktremu upyn okres
+// prbkowania, dostaje polecenie pomiaru, a scratchpad odczytywany jest po maksymalnym czasie
+// pomiaru w jego rozdzielczoci - niezalenie od pozostaych kanaw (dugi pomiar 12-bitowy
+// nie opnia kanaw o krtkim okresie); odczyty przed pomiarami, po jednym kanale
+// z kadej magistrali jednoczenie
+extern unsigned char ds_bus[DS_DEVICES_MAX];            // magistrala 1wire czujnika
+extern volatile unsigned char ds_cycle_ch[OW_BUSES];    // kana biecej transakcji na magistrali
+extern unsigned char ds_res[DS_DEVICES_MAX];            // rozdzielczo pomiaru kanau
+extern unsigned int  ds_countdown[DS_DEVICES_MAX];      // takty poolingu do kolejnego pomiaru kanau
+extern volatile unsigned char ds_cycle_state;
+extern volatile unsigned char ds_measuring;
+extern volatile unsigned char ds_due;
+extern volatile unsigned char ds_pending;
+extern volatile unsigned char ds_round;
+
+#define DS_CYCLE_IDLE       0
+#define DS_CYCLE_CONVERT    1
+#define DS_CYCLE_READ       2
+#define DS_CYCLE_ALARM      3   // przeszukiwanie Alarm Search kanaw z progami
+#define DS_CYCLE_DISCOVER   4   // wyszukiwanie doczonych / odczonych czujnikw
+
+// kanay z progami alarmowymi (TL < TH) odczytywane tylko, gdy czujnik zgosi alarm
+// w przeszukiwaniu Alarm Search po pomiarze - co DS_ALARM_REFRESH przeszukiwa odczytywane mimo braku alarmu
+#define DS_ALARM_REFRESH    10
+
+#define ds18b20_alarm_mode(ch)  ( my_config.ds_alarm_low[(ch)] < my_config.ds_alarm_high[(ch)] )
+
+extern volatile unsigned char ds_alarm;         // kanay z alarmem w ostatnim przeszukiwaniu
+extern volatile unsigned char ds_alarm_report;  // kanay, ktre weszy w alarm (do zgoszenia w ptli gwnej)
+extern volatile unsigned char ds_alarm_bus;     // przeszukiwana magistrala
+extern unsigned char ds_alarm_cycles;           // przeszukiwania od ostatniego penego odczytu
+
+// okres prbkowania kanau w taktach poolingu (25 ms)
+#define ds18b20_period(ch)  ( my_config.ds_period[(ch)] ? my_config.ds_period[(ch)] * 4 : 40 )
+
+// takty poolingu od polecenia pomiaru kanau / maksymalny czas pomiaru w rozdzielczoci kanau
+// (93,75 ms x 2^rozdzielczo zaokrglone w gr do 100 ms x 2^rozdzielczo)
+#define ds18b20_elapsed(ch)     ( ds18b20_period(ch) - ds_countdown[(ch)] )
+#define ds18b20_conversion(ch)  ( 4 << ds_res[(ch)] )
+
+// rozdzielczo, przy ktrej pomiar mieci si w okresie prbkowania (x 100 ms)
+unsigned char ds18b20_resolution_for(unsigned char);
+
+// co takt poolingu (25 ms)
+void ds18b20_pooling();
+
+// kolejna transakcja: odczyt kanaw z zakoczonym pomiarem (kanay z progami po przeszukiwaniu
+// Alarm Search), a gdy brak - pomiar kanaw, ktrym upyn okres prbkowania / zakoczenie
+// transakcji (w przerwaniu)
+void ds18b20_cycle_tx(unsigned char, unsigned char, unsigned char);
+void ds18b20_cycle_next();
+void ds18b20_cycle_done();
+void ds18b20_on_measure(unsigned char);
+void ds18b20_on_read(unsigned char);
+
+// zgo na RS zdarzenia czujnikw zapisane w przerwaniach (ptla gwna - wypisywanie trwa)
+void ds18b20_report();
+
+// przeszukiwanie Alarm Search kolejnej magistrali (od podanej) / znaleziony czujnik (w przerwaniu)
+void ds18b20_alarm_next(unsigned char);
+void ds18b20_on_alarm(unsigned char);
+
 // ustaw rozdzielczosc pomiaru temperatur
-// wszystkich czujnikow
-void ds18b20_set_resolution(unsigned char);
+// podanego czujnika (alarmy wyczone)
+void ds18b20_set_resolution(unsigned char*, unsigned char);
 
-// ustaw zakresy wyzwalania alarmow podanego czujnika
-void ds18b20_set_triggers(unsigned char*, signed char, signed char);
+// ustaw zakresy wyzwalania alarmow (TL, TH w st. C) i rozdzielczosc
+// podanego czujnika - flaga alarmu ustawiana po pomiarze, gdy T <= TL lub T >= TH
+void ds18b20_set_triggers(unsigned char*, signed char, signed char, unsigned char);
 
 // rozdzielczoci                           // precyzja     maksymalny czas pomiaru
 #define DS18B20_RESOLUTION_9_BITS    0b00   // 0.5C         93.75 ms
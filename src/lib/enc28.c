@@ -357,12 +357,8 @@ unsigned int enc28_packet_recv(unsigned char* packet, unsigned int maxlen)
 	rxstat  = enc28_read_opcode(ENC28_OPCODE_RBM, 0);
 	rxstat |= enc28_read_opcode(ENC28_OPCODE_RBM, 0)<<8;
 
-	// ogranicz rozmiar odebranego pakietu
-    if (len>maxlen-1)
-        len=maxlen-1;
-
-    // sprawd CRC i inne bledy transmisji
-    if ( (rxstat & 0x80) == 0 ){
+    // sprawd CRC i inne bledy transmisji, odrzuc pakiety dluzsze niz bufor (miejsce na znak NULL)
+    if ( ((rxstat & 0x80) == 0) || (len > maxlen-1) ){
         len=0;
     } else {
         // skopiuj pakiet z pamieci ENC28 do pamieci uC
@@ -458,3 +454,44 @@ void enc28_dump()
     */
 }
 /**/
+
+void enc28_hash_add(unsigned char* mac)
+{
+    unsigned long crc = 0xffffffff;
+    unsigned char i, j, byte, ptr;
+
+    // CRC-32 adresu docelowego liczone jak FCS ramki (wielomian 0x04C11DB7, bity od najmodszego)
+    for (i = 0; i < 6; i++) {
+        byte = mac[i];
+
+        for (j = 0; j < 8; j++) {
+            if ( ((crc >> 31) ^ byte) & 1 ) {
+                crc = (crc << 1) ^ 0x04C11DB7;
+            }
+            else {
+                crc <<= 1;
+            }
+
+            byte >>= 1;
+        }
+    }
+
+    // bity 28:23 CRC: 28:26 - numer rejestru EHT, 25:23 - bit w rejestrze
+    ptr = (crc >> 23) & 0x3f;
+
+    enc28_write_reg(ENC28_EHT0 + (ptr >> 3), enc28_read_reg(ENC28_EHT0 + (ptr >> 3)) | (1 << (ptr & 0x07)));
+
+    // przyjmuj ramki zgodne z tablic (filtry w trybie OR)
+    enc28_write_reg(ENC28_ERXFCON, enc28_read_reg(ENC28_ERXFCON) | ENC28_ERXFCON_HTEN);
+}
+
+void enc28_hash_clear()
+{
+    unsigned char i;
+
+    enc28_write_reg(ENC28_ERXFCON, enc28_read_reg(ENC28_ERXFCON) & ~ENC28_ERXFCON_HTEN);
+
+    for (i = 0; i < 8; i++) {
+        enc28_write_reg(ENC28_EHT0 + i, 0);
+    }
+}
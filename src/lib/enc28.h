@@ -250,8 +250,12 @@
 //
 #define ENC28_MAX_FRAMELEN      1518        // maksymalny rozmiar pakietu w sieci Ethernet - 1518 bajtow
 
-// bufor na pakiety
-uint8_t  net_packet[ENC28_MAX_FRAMELEN];
+// bufor na pakiety - ramki dluzsze sa odrzucane (segmenty TCP ogranicza opcja MSS, dluzsze odpowiedzi
+// HTTP wysylane sa w kilku segmentach - net_tcp_flush); koncowe 512 bajtow to bufor sektora karty SD
+#define NET_PACKET_LEN          600
+#define NET_PACKET_SD_BUF       (net_packet + NET_PACKET_LEN - 512)
+
+uint8_t  net_packet[NET_PACKET_LEN];
 
 // poczatek kolejnego odebranego pakietu w pamieci ENC28
 volatile uint16_t enc28_next_packet_ptr; 
@@ -267,6 +271,10 @@ void enc28_init();
 // inicjalizacja obslugi sieci przez ENC28
 void enc28_net_init(unsigned char*, unsigned char*);
 
+// filtr ramek multicast (tablica haszujca): dopu adres MAC / wyczy tablic
+void enc28_hash_add(unsigned char*);
+void enc28_hash_clear();
+
 // odczyt z / zapis do ENC28
 unsigned char enc28_read_opcode(unsigned char, unsigned char);
 void enc28_write_opcode(unsigned char, unsigned char, unsigned char);
@@ -3,50 +3,47 @@
 
 unsigned char fat_init(fat_partition* fat, unsigned char* buf) {
 
-    unsigned int i;
-	const unsigned char temp_name[] = "MSDOS";
+    unsigned long total;
 
-    // ustaw podany bufor jako bufor operacji systemu plikw 
+    // ustaw podany bufor jako bufor operacji systemu plikw
     fat_buffer = buf;
     fat_struct = fat;
 
+    // bufor nie zawiera jeszcze adnego sektora tablicy FAT
+    fat_cache_sector = FAT_CACHE_NONE;
+    fat_cache_dirty  = 0;
+
+    // zeruj struktur informacji o partycji
+	memset((void*) fat, 0, sizeof(fat_partition));
+
     // odczytaj pierwszy sektor (przynajmniej sprbuj)
 	if( !FAT_READ_SECTOR(0, fat_buffer) ) {
 		return 0;
     }
 
-    // zeruj struktur informacji o partycji
-	memset((void*) fat, 0, sizeof(fat_partition));
-	
 	// sprawdzanie, czy zerowy sektor karty to MASTER Boot Record, czy "Zwykly" Boot Record
-	// sprawdzanie poprzez nazwe "MSDOS", ktora w przypadku "Zwyklego" Boot Record'a jest wpsiana na poczatku sektora
-	for( i=3; i<8; i++) {
-		if(fat_buffer[i]!=temp_name[i-3]) {
-			// zerowy sektor to MBR
-			fat->part_first_sector_off = fat_buffer[FAT_PART_FIRST_SECTOR];
-			fat->type = fat_buffer[FAT_PART_TYPE];
-            
-            // wczytaj Boot Record partycji
-			if( ! FAT_READ_SECTOR(fat->part_first_sector_off, fat_buffer) ) {
-			    return 0;	
-            }
-		}
+	// Boot Record partycji zaczyna si od instrukcji skoku (0xEB xx 0x90 / 0xE9 xx xx)
+	if( (fat_buffer[0] != 0xEB) && (fat_buffer[0] != 0xE9) ) {
+		// zerowy sektor to MBR -> numer pierwszego sektora partycji (little endian)
+		fat->part_first_sector_off = (unsigned long)fat_buffer[FAT_PART_FIRST_SECTOR] |
+		                             (unsigned long)fat_buffer[FAT_PART_FIRST_SECTOR+1] << 8 |
+		                             (unsigned long)fat_buffer[FAT_PART_FIRST_SECTOR+2] << 16 |
+		                             (unsigned long)fat_buffer[FAT_PART_FIRST_SECTOR+3] << 24;
+		fat->type = fat_buffer[FAT_PART_TYPE];
+
+        // wczytaj Boot Record partycji
+		if( ! FAT_READ_SECTOR(fat->part_first_sector_off, fat_buffer) ) {
+		    return 0;
+        }
 	}
 
-    // typ partycji jeszcze nie znany?
-	if( !fat->type ) {
-		unsigned char temp_name1[] = "FAT16";
-
-        //sprawdzanie jaki typ partycji
-		for(i=0x36; i<0x36+5; i++) {
-			if ( fat_buffer[i] == temp_name1[i-0x36] ) {
-			    fat->type = FAT_FAT16;
-            }
-			else {
-			    fat->type = FAT_UNKNOWN;
-            }
-		}
-	}
+    // sprawdzanie jaki typ partycji (MBR mg poda 0x04 / 0x0E zamiast 0x06)
+    if ( memcmp((void*)(fat_buffer+0x36), (void*)"FAT16", 5) == 0 ) {
+        fat->type = FAT_FAT16;
+    }
+    else {
+        fat->type = FAT_UNKNOWN;
+    }
 
     // skopiuj opis typu partycji do pola name
     memcpy((void*)&(fat->name), (void*)(fat_buffer+0x36), 5);
@@ -54,47 +51,117 @@ unsigned char fat_init(fat_partition* fat, unsigned char* buf) {
 
     // ustaw pozostae pola struktury opisu partycji
 	fat->bytes_per_sector 		= fat_buffer[0x0B] | fat_buffer[0x0C]<<8;	//powinno byc 512
-	fat->sectors_per_cluster    = fat_buffer[0x0D];	
+	fat->sectors_per_cluster    = fat_buffer[0x0D];
 	fat->reserved_sectors		= fat_buffer[0x0E] | fat_buffer[0x0F]<<8;
 	fat->number_of_fat_tables	= fat_buffer[0x10];
 	fat->max_root_dir_entries	= fat_buffer[0x11] | fat_buffer[0x12]<<8;
 	fat->sectors_per_fat		= fat_buffer[0x16] | fat_buffer[0x17]<<8;
 	fat->total_sectors			= fat_buffer[0x13] | fat_buffer[0x14]<<8;
 	fat->fat_off				= fat->part_first_sector_off + fat->reserved_sectors;
-	
+
 	fat->root_dir_off			= fat->part_first_sector_off + fat->reserved_sectors +
-								  fat->number_of_fat_tables*fat->sectors_per_fat ;	
-								  
+								  (unsigned long)fat->number_of_fat_tables*fat->sectors_per_fat ;
+
 	fat->first_cluster_off       = fat->root_dir_off + (fat->max_root_dir_entries*32)/fat->bytes_per_sector - 2*fat->sectors_per_cluster;
 
-    rs_dump((unsigned char*)fat, sizeof(fat_partition));
+    // liczba sektorw partycji (pole 16-bitowe rwne 0 - rozmiar w polu 32-bitowym pod 0x20)
+    total = fat->total_sectors ? fat->total_sectors : ( (unsigned long)fat_buffer[0x20] | (unsigned long)fat_buffer[0x21] << 8 |
+                                                        (unsigned long)fat_buffer[0x22] << 16 | (unsigned long)fat_buffer[0x23] << 24 );
+
+    // klastry obszaru danych (#0 i #1 zarezerwowane) - ostatni sektor tablicy FAT ma zwykle wpisy za kocem partycji
+    total = (total - (fat->root_dir_off + (fat->max_root_dir_entries*32)/512 - fat->part_first_sector_off)) / (fat->sectors_per_cluster ? fat->sectors_per_cluster : 1) + 2;
 
-	return 1;	
-} 
+    fat->clusters = (total < ((unsigned long)fat->sectors_per_fat << 8)) ? total : ((unsigned long)fat->sectors_per_fat << 8);
+
+    // wolnych klastrw szukaj od pocztku obszaru danych
+    fat->free_cluster_hint       = 2;
+
+    // obsugujemy tylko sektory 512 bajtowe
+    if (fat->bytes_per_sector != 512 || !fat->sectors_per_cluster) {
+        fat->type = FAT_UNKNOWN;
+    }
+
+	return (fat->type == FAT_FAT16) ? 1 : 0;
+}
 
 
 unsigned int fat_cluster_read(unsigned long cluster) {
-    
-    unsigned long offset = (cluster << 1) % 512;
-	unsigned long sector = cluster >> 8; 
-	
-	FAT_READ_SECTOR( (fat_struct->fat_off + sector), fat_buffer);
 
-    // pobierz dwa bajty z odczytanego sektora karty
+    unsigned int offset = (cluster << 1) % 512;
+
+    // sektor tablicy FAT pobierany z karty tylko, gdy nie ma go ju w buforze
+	if ( !fat_cache_load(cluster >> 8) ) {
+	    return FAT_CLUSTER_LAST;
+    }
+
+    // pobierz dwa bajty z sektora tablicy FAT
 	return (fat_buffer[offset] | (unsigned int) fat_buffer[offset+1] << 8);
 }
 
 void fat_cluster_write(unsigned long cluster, unsigned int value) {
-    
-    unsigned long offset = (cluster << 1) % 512;
-	unsigned long sector = cluster >> 8; 
-	
-    FAT_READ_SECTOR( (fat_struct->fat_off + sector), fat_buffer);
+
+    unsigned int offset = (cluster << 1) % 512;
+
+    if ( !fat_cache_load(cluster >> 8) ) {
+        return;
+    }
 
 	fat_buffer[offset]   = (unsigned char) value;
 	fat_buffer[offset+1] = (unsigned char) (value >> 8);
-	
-    FAT_WRITE_SECTOR( (fat_struct->fat_off + sector), fat_buffer);
+
+    // sektor zostanie zapisany do wszystkich kopii tablicy FAT przy fat_cache_flush()
+    fat_cache_dirty = 1;
+}
+
+// wczytuje podany sektor tablicy FAT (liczony od jej pocztku) do bufora
+unsigned char fat_cache_load(unsigned int sector) {
+
+    // trafienie
+    if (fat_cache_sector == sector) {
+        return 1;
+    }
+
+    // zapisz zmieniony sektor, zanim bufor zostanie nadpisany
+    if ( !fat_cache_flush() ) {
+        return 0;
+    }
+
+    if ( !FAT_READ_SECTOR(fat_struct->fat_off + sector, fat_buffer) ) {
+        fat_cache_sector = FAT_CACHE_NONE;
+        return 0;
+    }
+
+    fat_cache_sector = sector;
+
+    return 1;
+}
+
+// zapisuje zmieniony sektor tablicy FAT do wszystkich jej kopii
+unsigned char fat_cache_flush(void) {
+
+    unsigned char n;
+
+    if (fat_cache_dirty && fat_cache_sector != FAT_CACHE_NONE) {
+        for (n=0; n < fat_struct->number_of_fat_tables; n++) {
+            if ( !FAT_WRITE_SECTOR( (fat_struct->fat_off + (unsigned long)n*fat_struct->sectors_per_fat + fat_cache_sector), fat_buffer) ) {
+                return 0;
+            }
+        }
+    }
+
+    fat_cache_dirty = 0;
+
+    return 1;
+}
+
+// zwalnia bufor na potrzeby odczytu / zapisu sektora katalogu lub danych
+unsigned char fat_cache_release(void) {
+
+    unsigned char ret = fat_cache_flush();
+
+    fat_cache_sector = FAT_CACHE_NONE;
+
+    return ret;
 }
 
 
@@ -105,9 +172,14 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
     unsigned int j;
     unsigned long sector;
 
+    // bufor potrzebny na sektory katalogu - zapisz zmieniony sektor tablicy FAT
+    if ( !fat_cache_release() ) {
+        return 0;
+    }
+
     // przygotuj struktur informacyjn pliku
     memset((void*) file, 0, sizeof(fat_file));
-    
+
     // wypenij pole nazwy pliku ...
     for(i=0; i<8; i++) {
 	    file->name[i] = fat_validate_char(name[i]);
@@ -118,13 +190,11 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
         file->ext[i] = fat_validate_char(ext[i]);
     }
 
-    rs_dump((void*)file, sizeof(fat_file));
-    
     // szukaj pliku w katalogu nadrzdnym -> moe plik istnieje
 	for(sector = fat_struct->root_dir_off; sector < (fat_struct->root_dir_off + fat_struct->max_root_dir_entries/16); sector++)
-	{			
+	{
 		FAT_READ_SECTOR(sector, fat_buffer);
-			
+
         // szukaj wrd kolejnych plikw
 		for(j=0; j<512; j+=32)
 		{
@@ -132,21 +202,30 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
 			if( fat_check_root_dir_entry(file, (unsigned char*) (fat_buffer+j)) ) {
 
 				file->first_cluster             = fat_buffer[j+26] | (unsigned int)fat_buffer[j+27]<<8;
-				file->size			            = (unsigned long)(fat_buffer[j+28]) | (unsigned long)(fat_buffer[j+29])<<8 | (unsigned long)(fat_buffer[j+30])<<16 | (unsigned long)(fat_buffer[j+31])<<24;	
-				file->number_of_entry_in_dir    = (sector - fat_struct->root_dir_off + j) / 32;
-				
+				file->size			            = (unsigned long)(fat_buffer[j+28]) | (unsigned long)(fat_buffer[j+29])<<8 | (unsigned long)(fat_buffer[j+30])<<16 | (unsigned long)(fat_buffer[j+31])<<24;
+				file->number_of_entry_in_dir    = (sector - fat_struct->root_dir_off)*16 + j/32;
+
+                // dopisujemy na kocu pliku
+                file->cur_pos = file->size;
+
+                // pusty plik (bez przydzielonych klastrw)
+                if (file->first_cluster == 0) {
+                    file->last_cluster = 0;
+                    return 1;
+                }
+
 				// przeszukaj tablic FAT w poszukiwaniu ostatniego klastra zajmowanego przez plik
 				unsigned int cluster_value = fat_cluster_read(file->first_cluster);
 				unsigned long cluster = file->first_cluster;
 
-				if (cluster_value < 0xFFF0) {
+				if (cluster_value < FAT_CLUSTER_EOC) {
                     // plik zajmuje wicej ni jeden klaster
 					do {
 						cluster_value = cluster;
-						cluster = fat_cluster_read(cluster_value);			
+						cluster = fat_cluster_read(cluster_value);
+
+					} while (cluster < FAT_CLUSTER_EOC);
 
-					} while (cluster < 0xFFF0);
-				    
                     file->last_cluster = cluster_value;
 				}
 				else {
@@ -154,8 +233,9 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
                     file->last_cluster = file->first_cluster;
 			    }
 
-                rs_dump((void*)file, sizeof(fat_file));
-				
+                // bufor wspdzielony - nie zostawiaj w nim sektora tablicy
+                fat_cache_release();
+
                 return 1;
 			}
         }
@@ -165,11 +245,15 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
     // utwrz nowy plik
     //
 
-    // przeszukuj katalog nadrzdny w poszukiwaniu wolnego miejsca na nowy wpis
+    // przeszukuj katalog nadrzdny w poszukiwaniu wolnego miejsca na nowy wpis (bufor mg przej sektor tablicy FAT)
+    if ( !fat_cache_release() ) {
+        return 0;
+    }
+
     for(sector = fat_struct->root_dir_off; sector < (fat_struct->root_dir_off + fat_struct->max_root_dir_entries/16); sector++)
 	{
 		FAT_READ_SECTOR(sector, fat_buffer);
-	
+
 		for(j=0; j<512; j+=32) {
 			if(fat_buffer[j] == 0 || fat_buffer[j] == 0xE5)
 			{
@@ -177,7 +261,7 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
 				file->number_of_entry_in_dir = ((sector-fat_struct->root_dir_off)*16 + j/32);
 				file->size = 1;
 				break;
-			}			
+			}
 		}
 
 		if(file->size)
@@ -192,32 +276,16 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
     // zeruj rozmiar pliku -> pole uyte jako flaga przy szukaniu wolnego miejsca na wpis
     file->size = 0;
 
-    rs_dump((void*)file, sizeof(fat_file));
-
-    sector = fat_find_free_cluster();
-			
-    // nie ma ju wolnego miejsca
-	if (sector >= 0xFFF0) {
-	    return 0;
-    }
+    // nowy plik nie zajmuje jeszcze adnego klastra (zostanie przydzielony przy pierwszym zapisie)
+    file->first_cluster = file->last_cluster = 0;
 
-    // wstpne ustawienie informacji o pliku (zajmowane sektory)
-    file->first_cluster = file->last_cluster  = sector;
-		
-    // nowy plik zajmuje jeden klaster
-    fat_cluster_write(file->first_cluster, 0xFFFF);	
-	
-    // odczytaj dane z katalogu nadrzdnego
-    sector = fat_struct->root_dir_off + (file->number_of_entry_in_dir >> 4); // /16
-    FAT_READ_SECTOR(sector, fat_buffer);
+    // sektor katalogu nadrzdnego z wolnym wpisem jest nadal w buforze
+    unsigned int offset = (file->number_of_entry_in_dir << 5) % 512; // 2^5 = 32
 
-    i = 0;
-
-    unsigned long offset = (file->number_of_entry_in_dir << 5) % 512; // 2^5 = 32
-	
     //
     // dokonaj wpisu do katalogu nadrzdnego
     //
+    memset((void*)(fat_buffer+offset), 0, 32);
 
     // nazwa
     for(i=0; i<8; i++) {
@@ -228,54 +296,191 @@ unsigned char fat_file_open(fat_file* file, unsigned char* name, unsigned char*
     for (i=0; i<3; i++) {
 	    fat_buffer[offset+i+8] = file->ext[i];
     }
-	
+
     // atrybuty pliku: archiwalny
-	fat_buffer[offset+0x0b] = 0x20;
+	fat_buffer[offset+FAT_ENTRY_ATTR] = FAT_ATTR_ARCHIVE;
 
-    // numer pierwszego klastra pliku
-	fat_buffer[offset+0x1a] = file->first_cluster & 0x00FF;
-	fat_buffer[offset+0x1b] = file->first_cluster >> 8;
-				
-    // rozmiar pliku
-	fat_buffer[offset+0x1c] = file->size & 0x0000FF;
-	fat_buffer[offset+0x1d] = file->size >> 8;
-	fat_buffer[offset+0x1e] = file->size >> 16;
+    // czas / data utworzenia pliku
+    time_t time;
+    ds1306_time_get(&time);
+
+    j = fat_get_time(&time);
+    fat_buffer[offset+FAT_ENTRY_CTIME]   = fat_buffer[offset+FAT_ENTRY_MTIME]   = j & 0xff;
+    fat_buffer[offset+FAT_ENTRY_CTIME+1] = fat_buffer[offset+FAT_ENTRY_MTIME+1] = j >> 8;
+
+    j = fat_get_date(&time);
+    fat_buffer[offset+FAT_ENTRY_CDATE]   = fat_buffer[offset+FAT_ENTRY_MDATE]   = fat_buffer[offset+FAT_ENTRY_ADATE]   = j & 0xff;
+    fat_buffer[offset+FAT_ENTRY_CDATE+1] = fat_buffer[offset+FAT_ENTRY_MDATE+1] = fat_buffer[offset+FAT_ENTRY_ADATE+1] = j >> 8;
 
     // zapisz wpis
     FAT_WRITE_SECTOR(sector, fat_buffer);
 
-    rs_dump((void*)file, sizeof(fat_file));
-
     return 1;
 }
 
 
-unsigned char fat_file_write(fat_file* file, unsigned char* buf, unsigned int len) {
-    
+unsigned int fat_file_write(fat_file* file, unsigned char* buf, unsigned int len) {
+
+    unsigned int written = 0;
+    unsigned int pos, n;
+    unsigned long sector;
+
+    // rozmiar klastra w bajtach
+    unsigned long cluster_size = (unsigned long)fat_struct->sectors_per_cluster << 9;
+
     // czy mamy otwarty plik?
     if (!file->name[0]) {
         return 0;
     }
 
-    // liczba sektorw i klastrw zajmowanych przez plik - 1
-    unsigned long file_sectors = file->size / 512;
-    unsigned long file_clusters = file_sectors / fat_struct->sectors_per_cluster;
+    while (len > 0) {
+
+        // pierwszy zapis do pustego pliku lub zapeniony ostatni klaster -> docz kolejny
+        if ( (file->last_cluster == 0) || ((file->size % cluster_size) == 0 && file->size > 0) ) {
+            if ( !fat_file_add_cluster(file) ) {
+                break;
+            }
+        }
+
+        // zapisz zmiany w tablicy FAT - bufor potrzebny na sektor danych
+        if ( !fat_cache_release() ) {
+            break;
+        }
+
+        // do ktrego sektora odbdzie si zapis
+        sector = fat_struct->first_cluster_off + (unsigned long)file->last_cluster * fat_struct->sectors_per_cluster + (file->size % cluster_size) / 512;
+
+        // pooenie w sektorze i liczba bajtw mieszczcych si w nim
+        pos = file->size % 512;
+        n   = (len < (512 - pos)) ? len : (512 - pos);
+
+        // dopisujemy do czciowo zapenionego sektora -> odczytaj go
+        if (pos > 0) {
+            FAT_READ_SECTOR(sector, fat_buffer);
+        }
+        else {
+            memset((void*)fat_buffer, 0, 512);
+        }
+
+        memcpy((void*)(fat_buffer + pos), (void*)buf, n);
+
+        // zapisz
+        if ( !FAT_WRITE_SECTOR(sector, fat_buffer) ) {
+            break;
+        }
+
+        file->cur_pos += n;
+        file->size    += n;
+
+        buf     += n;
+        len     -= n;
+        written += n;
+    }
+
+    // aktualizuj rozmiar pliku w katalogu (plik czytelny na PC bez zamykania)
+    if (written > 0) {
+        fat_file_update_entry(file);
+    }
+
+    // zapisz zmiany w tablicy FAT take po nieudanym zapisie (bufor wspdzielony)
+    fat_cache_release();
+
+    return written;
+}
+
+// zamknij plik
+unsigned char fat_file_close(fat_file* file) {
+
+    unsigned char ret = 1;
+
+    if (file->name[0]) {
+        ret = fat_file_update_entry(file);
+    }
+
+    // plik zamknity
+    file->name[0] = 0;
+
+    return ret;
+}
+
+// docza nowy klaster na kocu acucha klastrw pliku
+unsigned char fat_file_add_cluster(fat_file* file) {
 
-    // do ktrego sektora odbdzie si zapis
-    unsigned long sector = fat_struct->first_cluster_off;
-    
-    //sector += fat_struct->sectors_per_cluster * (unsigned long) tablica_klastrow[clusters_in_row] + file_sector%fat_struct->sectors_per_cluster;
+    unsigned long cluster = fat_find_free_cluster();
 
-    // zapisz
-    FAT_WRITE_SECTOR(sector, buf);
-	
-	file->cur_pos 		+= len;
-	file->size    		+= len;
-	//plik->last_cluster 	=  tablica_klastrow[clusters_in_row];
+    // nie ma ju wolnego miejsca
+	if (cluster >= FAT_CLUSTER_EOC) {
+	    return 0;
+    }
+
+    // nowy klaster koczy acuch...
+    fat_cluster_write(cluster, FAT_CLUSTER_LAST);
+
+    if (file->last_cluster == 0) {
+        // ... pierwszy klaster pliku
+        file->first_cluster = cluster;
+    }
+    else {
+        // ... docz go do poprzedniego ostatniego klastra
+        fat_cluster_write(file->last_cluster, cluster);
+    }
+
+    file->last_cluster = cluster;
 
     return 1;
 }
 
+// aktualizuje rozmiar / czas modyfikacji pliku we wpisie katalogu gwnego
+unsigned char fat_file_update_entry(fat_file* file) {
+
+    unsigned long sector = fat_struct->root_dir_off + (file->number_of_entry_in_dir >> 4); // /16
+    unsigned int offset  = (file->number_of_entry_in_dir << 5) % 512; // 2^5 = 32
+    unsigned int val;
+    time_t time;
+
+    if ( !fat_cache_release() || !FAT_READ_SECTOR(sector, fat_buffer) ) {
+        return 0;
+    }
+
+    // upewnij si, e to nadal wpis naszego pliku
+    if ( !fat_check_root_dir_entry(file, fat_buffer+offset) ) {
+        return 0;
+    }
+
+    // numer pierwszego klastra pliku
+	fat_buffer[offset+FAT_ENTRY_CLUSTER]   = file->first_cluster & 0x00FF;
+	fat_buffer[offset+FAT_ENTRY_CLUSTER+1] = file->first_cluster >> 8;
+
+    // rozmiar pliku
+	fat_buffer[offset+FAT_ENTRY_SIZE]   = file->size;
+	fat_buffer[offset+FAT_ENTRY_SIZE+1] = file->size >> 8;
+	fat_buffer[offset+FAT_ENTRY_SIZE+2] = file->size >> 16;
+	fat_buffer[offset+FAT_ENTRY_SIZE+3] = file->size >> 24;
+
+    // czas / data modyfikacji
+    ds1306_time_get(&time);
+
+    val = fat_get_time(&time);
+    fat_buffer[offset+FAT_ENTRY_MTIME]   = val & 0xff;
+    fat_buffer[offset+FAT_ENTRY_MTIME+1] = val >> 8;
+
+    val = fat_get_date(&time);
+    fat_buffer[offset+FAT_ENTRY_MDATE]   = fat_buffer[offset+FAT_ENTRY_ADATE]   = val & 0xff;
+    fat_buffer[offset+FAT_ENTRY_MDATE+1] = fat_buffer[offset+FAT_ENTRY_ADATE+1] = val >> 8;
+
+    return FAT_WRITE_SECTOR(sector, fat_buffer);
+}
+
+// czas w formacie FAT'owskim: gggggmmmmmmsssss (sekundy / 2)
+unsigned int fat_get_time(time_t* time) {
+    return ((unsigned int)time->tm_hour << 11) | ((unsigned int)time->tm_min << 5) | (time->tm_sec >> 1);
+}
+
+// data w formacie FAT'owskim: rrrrrrrmmmmddddd (rok liczony od 1980)
+unsigned int fat_get_date(time_t* time) {
+    return ((unsigned int)(time->tm_year + 20) << 9) | ((unsigned int)time->tm_mon << 5) | time->tm_mday;
+}
+
 
 
 // dokonuje zamiany liter na wielkie, znaki nieobsugiwane przez FAT zamieniane na 'X'
@@ -289,7 +494,7 @@ unsigned char fat_validate_char(unsigned char c)
 	return c;           // ok
 }
 
-// porwnuje podany wpis w katalogu nadrzdnym 
+// porwnuje podany wpis w katalogu nadrzdnym
 unsigned char fat_check_root_dir_entry(fat_file* file, unsigned char* buf) {
 
     unsigned char i;
@@ -311,26 +516,23 @@ unsigned char fat_check_root_dir_entry(fat_file* file, unsigned char* buf) {
     return 1;
 }
 
-// znajduje numer pierwszego wolnego klustra
+// znajduje numer pierwszego wolnego klustra (poczwszy od podpowiedzi free_cluster_hint)
 unsigned long fat_find_free_cluster(void) {
 
-	unsigned int sector;
-	unsigned int i;
-	unsigned int val;
-	unsigned int cluster_counter=0;		
-	
-	for(sector = 0; sector < fat_struct->sectors_per_fat; sector++) {		
-		
-        FAT_READ_SECTOR(fat_struct->fat_off + sector, fat_buffer);
-		
-		for(i=0; i<512; i+=2) {
-			val = (unsigned int)fat_buffer[i] | (unsigned int)fat_buffer[i+1]<<8;			
-
-			if(val == 0) {
-				return cluster_counter;
-            }
+	unsigned long cluster = fat_struct->free_cluster_hint;
+	unsigned long count   = fat_struct->clusters;
+	unsigned long n;
+
+	for (n = 0; n < count; n++, cluster++) {
+
+        // zawi na pocztek obszaru danych (klastry #0 i #1 s zarezerwowane)
+		if (cluster >= count || cluster < 2) {
+			cluster = 2;
+		}
 
-			cluster_counter++;
+		if (fat_cluster_read(cluster) == FAT_CLUSTER_FREE) {
+			fat_struct->free_cluster_hint = cluster + 1;
+			return cluster;
 		}
 	}
 
@@ -22,6 +22,21 @@
 #define FAT_ATTR_SYSTEM		0x04
 #define FAT_ATTR_ARCHIVE    0x20
 
+// wartoci wpisw tablicy FAT16
+#define FAT_CLUSTER_FREE    0x0000
+#define FAT_CLUSTER_LAST    0xFFFF  // koniec acucha klastrw
+#define FAT_CLUSTER_EOC     0xFFF8  // wartoci >= oznaczaj koniec acucha
+
+// offsety pl wpisu w katalogu gwnym (32 bajty)
+#define FAT_ENTRY_ATTR      0x0B
+#define FAT_ENTRY_CTIME     0x0E
+#define FAT_ENTRY_CDATE     0x10
+#define FAT_ENTRY_ADATE     0x12
+#define FAT_ENTRY_MTIME     0x16
+#define FAT_ENTRY_MDATE     0x18
+#define FAT_ENTRY_CLUSTER   0x1A
+#define FAT_ENTRY_SIZE      0x1C
+
 // funkcje zapisu / odczytu sektorw urzdzenia (warstwa abstrakcji)
 #define FAT_READ_SECTOR(sector, buf)    sd_read_block(sector, buf)
 #define FAT_WRITE_SECTOR(sector, buf)   sd_write_block(sector, buf)
@@ -40,10 +55,12 @@ typedef struct
 	unsigned char 	number_of_fat_tables;	///< 0x10		Ilosc kopii tablic FAT (zwykle 2)		1 byte
 	unsigned int 	max_root_dir_entries;	///< 0x11		Max liczba wpisow w Root Directory		2 bytes
 	unsigned int 	sectors_per_fat;		///< 0x16		Liczba sektorow na jedna tablice FAT	2 bytes
-	unsigned int 	first_cluster_off ;		///< Pierwszy klaster danych
-	unsigned int  	root_dir_off;			///< Pierwszy sektor Root Directory
-	unsigned int  	fat_off;				///< Pierwszy sektor tablicy FAT
+	unsigned long 	first_cluster_off ;		///< Pierwszy klaster danych
+	unsigned long  	root_dir_off;			///< Pierwszy sektor Root Directory
+	unsigned long  	fat_off;				///< Pierwszy sektor tablicy FAT
 	unsigned int 	total_sectors;			///< 0x13		Calkowita liczba dostenych sektorow		2 bytes
+	unsigned int 	free_cluster_hint;		///< Od tego klastra zaczyna si szukanie wolnego miejsca
+	unsigned int 	clusters;				///< Numer ostatniego klastra danych + 1 (wpisy tablicy FAT dalej nie opisuj partycji)
 
 } fat_partition;
 
@@ -63,6 +80,14 @@ typedef struct
 unsigned char* fat_buffer;
 fat_partition* fat_struct;
 
+// sektor tablicy FAT aktualnie przechowywany w fat_buffer (write-back) - zapisywany i zwalniany, gdy bufor
+// jest potrzebny na sektor katalogu lub danych, oraz na kocu kadej operacji na pliku (bufor ley w buforze
+// pakietw i jest wspdzielony z FS, dziennikiem i agregatami)
+#define FAT_CACHE_NONE      0xFFFF
+
+unsigned int  fat_cache_sector;     // numer sektora liczony od pocztku tablicy FAT
+unsigned char fat_cache_dirty;      // sektor zmieniony - wymaga zapisu
+
 // inicjalizacja systemu - odczyt danych o partycji, wykrycie typu, rozmiaru
 unsigned char fat_init(fat_partition*, unsigned char*);
 
@@ -78,15 +103,18 @@ void fat_cluster_write(unsigned long, unsigned int);
 // otwrz istniejcy / utwrz nowy plik
 unsigned char fat_file_open(fat_file*, unsigned char*, unsigned char*);
 
-// zapis do pliku
-unsigned char fat_file_write(fat_file*, unsigned char*, unsigned int);
+// dopisz dane na koniec pliku (zwraca liczb zapisanych bajtw)
+unsigned int fat_file_write(fat_file*, unsigned char*, unsigned int);
 
 // odczyt z pliku
 unsigned char fat_file_read(fat_file*, unsigned char*, unsigned int);
 
-// zamknij plik
+// zamknij plik - aktualizuj wpis w katalogu gwnym
 unsigned char fat_file_close(fat_file*);
 
+// czy partycja FAT16 zostaa zamontowana?
+#define fat_is_mounted()    ( fat_struct && fat_struct->type == FAT_FAT16 )
+
 
 //
 // funkcje wewntrzne
@@ -101,7 +129,19 @@ unsigned char fat_check_root_dir_entry(fat_file*, unsigned char*);
 // znajduje numer pierwszego wolnego klustra
 unsigned long fat_find_free_cluster(void);
 
-// zwraca aktualny czas w formacie FAT'owskim
-//unsigned int fat_get_time();
+// obsuga bufora sektora tablicy FAT
+unsigned char fat_cache_load(unsigned int);
+unsigned char fat_cache_flush(void);
+unsigned char fat_cache_release(void);
+
+// docza nowy klaster na kocu acucha klastrw pliku
+unsigned char fat_file_add_cluster(fat_file*);
+
+// aktualizuje rozmiar / czas modyfikacji pliku we wpisie katalogu gwnego
+unsigned char fat_file_update_entry(fat_file*);
+
+// zwraca aktualny czas / dat w formacie FAT'owskim
+unsigned int fat_get_time(time_t*);
+unsigned int fat_get_date(time_t*);
 
 #endif
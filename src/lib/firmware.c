@@ -82,28 +82,42 @@ unsigned int firmware_read_sector(unsigned char sector, unsigned char* buf)
 
     rs_int(length); rs_send('B'); rs_newline();
 
+    len = firmware_read_part(sector, 0, buf, length);
+
+    //rs_text_P(PSTR("Returned -> ")); rs_int(len); rs_send('B'); rs_newline();
+
+    return len;
+}
+
+// czyta <len> bajtow danych sektora od pozycji <offset> (dane po 255 bajtow na 256-bajtowej stronie)
+// zwraca liczbe odczytanych bajtow - 0 po koncu danych sektora
+unsigned int firmware_read_part(unsigned char sector, unsigned int offset, unsigned char* buf, unsigned int len)
+{
+    unsigned int length, n, read = 0;
+
+    // pobierz rozmiar danych w sektorze
+    length = firmware_get_sector_length(sector);
+
     // kontrola dugoci pakietu
-    if (length > FIRMWARE_SECTOR_SIZE)
+    if ( (length > FIRMWARE_SECTOR_SIZE) || (offset >= length) )
         return 0;
 
-    // pierwsza strona w danym sektorze
-    unsigned int page = sector * FIRMWARE_SECTOR_SIZE;
-
-    len = length;
+    if (len > length - offset)
+        len = length - offset;
 
     while (len > 0) {
-        // czytaj po stronie pamieci (po 256 bajtow)
-        eeprom_page_read(page, buf, (len > 255 ? 255 : len));
+        // czytaj do konca strony pamieci
+        n = 255 - offset % 255;
+        n = (len > n) ? n : len;
 
-        //rs_dump(buf, 255);
+        eeprom_page_read((unsigned long) sector * FIRMWARE_SECTOR_SIZE + (offset / 255) * 0x0100 + offset % 255, buf, n);
 
         // przesun wskaznik docelowy dla danych
-        buf += 255;
-        len -= (len > 255 ? 255 : len);
-        page += 0x0100;
+        buf    += n;
+        offset += n;
+        len    -= n;
+        read   += n;
     }
 
-    //rs_text_P(PSTR("Returned -> ")); rs_int(length); rs_send('B'); rs_newline();
-
-    return length;
+    return read;
 }
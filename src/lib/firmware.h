@@ -28,5 +28,6 @@ typedef struct {
 unsigned int firmware_handle_packet(unsigned char*);
 unsigned int firmware_get_sector_length(unsigned char);
 unsigned int firmware_read_sector(unsigned char, unsigned char*);
+unsigned int firmware_read_part(unsigned char, unsigned int, unsigned char*, unsigned int);
 
 #endif
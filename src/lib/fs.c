@@ -13,6 +13,7 @@ unsigned char fs_open(fs_file* file, unsigned char* name, unsigned char params)
 
     // dane sektora
     fs_sector* sector_data = (fs_sector*) fs_buf;
+    fs_sector header;
 
     // inicjalizacja struktury file
     memset((void*) file, 0, sizeof(fs_file));
@@ -27,13 +28,11 @@ unsigned char fs_open(fs_file* file, unsigned char* name, unsigned char params)
     sector = fs_find(name);
 
     // znaleziono plik
-    if (sector) {
-
-        //rs_dump((void*)fs_buf, 512);
+    if ( sector && fs_read_header(sector, &header) ) {
 
-        file->timestamp = sector_data->timestamp;
+        file->timestamp = header.timestamp;
         file->sector    = sector;
-        file->size      = sector_data->size;
+        file->size      = header.size;
         file->pos       = 0;
 
         return 1;
@@ -64,7 +63,7 @@ unsigned char fs_open(fs_file* file, unsigned char* name, unsigned char params)
         // ustaw dane
         sector_data->flag = FS_FLAG_FILE;
         strcpy((char*)(sector_data->name), (char*)file->name);
-        sector_data->timestamp = 0UL;
+        sector_data->timestamp = file->timestamp = fs_get_time();
         sector_data->size = 0;
 
         // zapis
@@ -113,14 +112,10 @@ unsigned int fs_read(fs_file* file, unsigned char* buf, unsigned int len) {
         return 0;
     }
 
-    // dane sektora
-    fs_sector* sector_data = (fs_sector*) fs_buf;
-
-    // odczytaj sektor
-    fs_read_sector(file->sector);
-
     // kopiuj dane
-    memcpy((void*)buf, (void*)(sector_data->data) + file->pos, len);
+    if ( !fs_read_data(file->sector, file->pos, buf, len) ) {
+        return 0;
+    }
 
     // zwiksz informacj o wskaniku pliku
     file->pos += len;
@@ -150,19 +145,19 @@ unsigned long fs_find(unsigned char* name) {
     unsigned long sector;
     unsigned long sectors = fs_number_of_sectors();
 
-    // zrzutuj dane sektora do struktury jego opisu
-    fs_sector* sector_data = (fs_sector*) fs_buf;
+    // nagwek sektora
+    fs_sector header;
     
     // sprawdzaj kolejne sektory
     for (sector = 1; sector < sectors; sector++) {
-        fs_read_sector(sector);
+        fs_read_header(sector, &header);
 
         // szukaj tylko wrd sektorw oznaczonych jako zawierajce pliki
-        if ( sector_data->flag != FS_FLAG_FILE )
+        if ( header.flag != FS_FLAG_FILE )
             continue;
 
         // znaleziono plik?
-        if ( strcmp((char*)(sector_data->name), (char*)name) == 0 )
+        if ( strcmp((char*)(header.name), (char*)name) == 0 )
             return sector;
     }
     
@@ -175,15 +170,15 @@ unsigned long fs_find_sector() {
     unsigned long sector;
     unsigned long sectors = fs_number_of_sectors();
 
-    // zrzutuj dane sektora do struktury jego opisu
-    fs_sector* sector_data = (fs_sector*) fs_buf;
+    // nagwek sektora
+    fs_sector header;
     
     // sprawdzaj kolejne sektory
     for (sector = 1; sector < sectors; sector++) {
-        fs_read_sector(sector);
+        fs_read_header(sector, &header);
 
         // znaleziono pusty sektor - nieustawiona flaga FS_FILE
-        if ( sector_data->flag != FS_FLAG_FILE )
+        if ( header.flag != FS_FLAG_FILE )
             return sector;
     }
     
@@ -196,24 +191,24 @@ unsigned long fs_list_files(fs_file* file, unsigned long sector) {
     // liczba sektorw dostpnych dla systemu plikw
     unsigned long sectors = fs_number_of_sectors();
     
-    // zrzutuj dane sektora do struktury jego opisu
-    fs_sector* sector_data = (fs_sector*) fs_buf;
+    // nagwek sektora
+    fs_sector header;
 
     // za kadym razem szukaj kolejnego sektora
     for (; sector < sectors; sector++) {
-        fs_read_sector(sector);
+        fs_read_header(sector, &header);
 
         // znaleziono sektor z plikiem
-        if ( sector_data->flag == FS_FLAG_FILE ) {
+        if ( header.flag == FS_FLAG_FILE ) {
             // kopiuj nazw pliku
-            strcpy( (char*)file->name, (char*)(sector_data->name));
+            strcpy( (char*)file->name, (char*)(header.name));
 
             //rs_send('>'); rs_text((char*)file->name); rs_newline();
 
             // pozostae dane o pliku
-            file->timestamp = sector_data->timestamp;
+            file->timestamp = header.timestamp;
             file->sector    = sector;
-            file->size      = sector_data->size;
+            file->size      = header.size;
             file->pos       = 0;
 
             return ++sector;
@@ -223,3 +218,13 @@ unsigned long fs_list_files(fs_file* file, unsigned long sector) {
 
     return 0;
 }
+
+unsigned long fs_get_time() {
+
+    time_t time;
+
+    // czas z zegara RTC (synchronizowanego z NTP)
+    ds1306_time_get(&time);
+
+    return mktime(&time);
+}
@@ -32,7 +32,7 @@ typedef struct {
 
 #include "../telemetry.h"
 
-// bufor na operacje I/O
+// bufor na operacje I/O (uywany tylko przy zapisie)
 unsigned char* fs_buf;
 
 // inicjalizacja systemu plikw
@@ -63,10 +63,17 @@ unsigned long fs_find_sector();
 // listuje pliki szukajc w systemie poczwszy od podanego sektora
 unsigned long fs_list_files(fs_file*, unsigned long);
 
+// czas utworzenia pliku (sekundy od 1970-01-01 wg zegara RTC)
+unsigned long fs_get_time();
+
 // funkcje zapisu / odczytu sektorw urzdzenia (warstwa abstrakcji)
 #define fs_read_sector(sector)    sd_read_block(sector, fs_buf)
 #define fs_write_sector(sector)   sd_write_block(sector, fs_buf)
 
+// odczyt nagwka sektora / fragmentu danych pliku z pominiciem bufora I/O (wspdzielonego z buforem pakietw)
+#define fs_read_header(sector, header)      sd_read_part(sector, 0, (unsigned char*)(header), sizeof(fs_sector))
+#define fs_read_data(sector, pos, buf, len) sd_read_part(sector, sizeof(fs_sector) + (pos), buf, len)
+
 // sprawd urzdzenie
 #define fs_is_medium_ok()         ( sd_get_state() != SD_FAILED )
 
@@ -0,0 +1,652 @@
+#include "../telemetry.h"
+
+unsigned char journal_init(unsigned char* buf) {
+
+    unsigned long last_sector;
+    unsigned long seq, first_seq;
+    unsigned long lo, hi, mid, ref;
+    unsigned char slot;
+
+    journal_record* rec;
+
+    // ustawienie wskazanego bufora na operacje I/O
+    journal_buf = buf;
+
+    journal_sectors = 0;
+    journal_seq     = 0;
+
+    journal_index_ready = 0;
+
+    if (sd_get_state() == SD_FAILED) {
+        return 0;
+    }
+
+    // wyznacz obszar dziennika: za systemem plikw FS i sektorami kopii, przed partycj FAT i w granicach karty
+    journal_first_sector = JOURNAL_FIRST_SECTOR + JOURNAL_SHADOW_SECTORS;
+    last_sector          = JOURNAL_FIRST_SECTOR + JOURNAL_SECTORS;
+
+    if ( last_sector > (sd_size >> 9) ) {
+        last_sector = sd_size >> 9;
+    }
+
+    if ( fat_is_mounted() && (fat.part_first_sector_off < last_sector) ) {
+        last_sector = fat.part_first_sector_off;
+    }
+
+    if (last_sector <= journal_first_sector) {
+        return 0;
+    }
+
+    // liczba sektorw - wielokrotno bloku kasowanego z wyprzedzeniem
+    journal_sectors = ((last_sector - journal_first_sector) / JOURNAL_ERASE_AHEAD) * JOURNAL_ERASE_AHEAD;
+
+    if (journal_sectors < 2*JOURNAL_ERASE_AHEAD) {
+        journal_sectors = 0;
+        return 0;
+    }
+
+    // indeks czasowy (jeden wpis na sektor dziennika) - o ile mieci si przed partycj FAT
+    last_sector = JOURNAL_INDEX_FIRST_SECTOR + JOURNAL_SECTORS / JOURNAL_INDEX_PER_SECTOR;
+
+    journal_index_ready = (last_sector <= (sd_size >> 9)) && !( fat_is_mounted() && (fat.part_first_sector_off < last_sector) );
+
+    //
+    // odtwrz koniec dziennika
+    //
+
+    // sektor odniesienia: pierwszy sektor piercienia lub - gdy ten zosta skasowany z wyprzedzeniem
+    // (koniec dziennika w ostatnim bloku) - pierwszy sektor kolejnego bloku
+    if ( journal_sector_seq(0, &first_seq) ) {
+        ref = 0;
+    }
+    else if ( journal_sector_seq(JOURNAL_ERASE_AHEAD, &first_seq) ) {
+        ref = JOURNAL_ERASE_AHEAD;
+    }
+    else {
+        // koniec dziennika przy rozpoczciu nowego "okrenia" piercienia
+        if ( journal_sector_seq(journal_sectors - 1, &seq) ) {
+            journal_seq = seq + JOURNAL_RECORDS_PER_SECTOR;
+        }
+
+        // w przeciwnym razie pusty dziennik - rekordy niepenego sektora w kopiach
+        journal_shadow_recover();
+
+        return 1;
+    }
+
+    // wyszukiwanie binarne ostatniego sektora zapisanego w biecym "okreniu" piercienia
+    // (numery sekwencyjne rosn w nim dokadnie o JOURNAL_RECORDS_PER_SECTOR na sektor)
+    lo = ref;
+    hi = journal_sectors - 1;
+
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+
+        if ( journal_sector_seq(mid, &seq) && (seq == first_seq + (mid - ref)*JOURNAL_RECORDS_PER_SECTOR) ) {
+            lo = mid;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    seq = first_seq + (lo - ref)*JOURNAL_RECORDS_PER_SECTOR;
+
+    // przeszukaj liniowo rekordy ostatniego sektora
+    sd_read_block(journal_first_sector + lo, journal_buf);
+
+    for (slot = 0; slot < JOURNAL_RECORDS_PER_SECTOR; slot++) {
+        rec = (journal_record*) (journal_buf + slot*JOURNAL_RECORD_SIZE);
+
+        if ( (rec->seq != seq + slot) || (rec->crc != journal_crc(rec)) ) {
+            break;
+        }
+    }
+
+    journal_seq = seq + slot;
+
+    // sektory piercienia zapisywane s w caoci - rekordy kolejnego, niepenego sektora (lub sektora
+    // z przerwanym zapisem) w kopiach
+    journal_shadow_recover();
+
+    return 1;
+}
+
+void journal_shadow_recover() {
+
+    // pierwszy rekord sektora koca dziennika
+    unsigned long first = journal_seq - (journal_seq % JOURNAL_RECORDS_PER_SECTOR);
+    unsigned char n, slot;
+
+    journal_record* rec;
+
+    // kopia z najwiksz liczb kolejnych rekordw sektora (pozostaa kopia jest o rekord krtsza
+    // lub dotyczy poprzedniego sektora)
+    for (n = 0; n < JOURNAL_SHADOW_SECTORS; n++) {
+        if ( !sd_read_block(JOURNAL_FIRST_SECTOR + n, journal_buf) ) {
+            continue;
+        }
+
+        for (slot = 0; slot < JOURNAL_RECORDS_PER_SECTOR - 1; slot++) {
+            rec = (journal_record*) (journal_buf + slot*JOURNAL_RECORD_SIZE);
+
+            if ( (rec->seq != first + slot) || (rec->crc != journal_crc(rec)) ) {
+                break;
+            }
+        }
+
+        if (first + slot > journal_seq) {
+            journal_seq = first + slot;
+        }
+    }
+}
+
+unsigned long journal_append(journal_record* record) {
+
+    unsigned long sector;
+    unsigned char slot;
+
+    journal_record* rec;
+
+    if ( !journal_is_ready() ) {
+        return JOURNAL_SEQ_NONE;
+    }
+
+    sector = (journal_seq / JOURNAL_RECORDS_PER_SECTOR) % journal_sectors;
+    slot   = journal_seq % JOURNAL_RECORDS_PER_SECTOR;
+
+    if (slot == 0) {
+        // rozpoczynamy nowy blok sektorw - skasuj z wyprzedzeniem kolejny
+        if ( (sector % JOURNAL_ERASE_AHEAD) == 0 ) {
+            unsigned long erase = (sector + JOURNAL_ERASE_AHEAD) % journal_sectors;
+
+            sd_erase(journal_first_sector + erase, journal_first_sector + erase + JOURNAL_ERASE_AHEAD - 1);
+        }
+
+        // nowy sektor - poprzednia zawarto nie jest potrzebna
+        memset((void*)journal_buf, 0xff, 512);
+    }
+    else {
+        // dopisujemy do poprzednich rekordw sektora (kopia zapisana z poprzednim rekordem)
+        if ( !sd_read_block(journal_shadow_sector(slot - 1), journal_buf) ) {
+            return JOURNAL_SEQ_NONE;
+        }
+    }
+
+    // nadaj numer sekwencyjny i sum kontroln
+    record->seq = journal_seq;
+    record->crc = journal_crc(record);
+
+    rec = (journal_record*) (journal_buf + slot*JOURNAL_RECORD_SIZE);
+    memcpy((void*)rec, (void*)record, JOURNAL_RECORD_SIZE);
+
+    // niepeny sektor - do kopii innej ni ta z poprzednim rekordem, peny - jednokrotnie na miejsce w piercieniu
+    if ( !sd_write_block((slot < JOURNAL_RECORDS_PER_SECTOR - 1) ? journal_shadow_sector(slot) : journal_first_sector + sector, journal_buf) ) {
+        return JOURNAL_SEQ_NONE;
+    }
+
+    // sektor zapeniony - dopisz go do indeksu czasowego
+    if (slot == JOURNAL_RECORDS_PER_SECTOR - 1) {
+        journal_index_write(journal_seq / JOURNAL_RECORDS_PER_SECTOR);
+    }
+
+    return journal_seq++;
+}
+
+unsigned char journal_read(unsigned long seq, journal_record* rec) {
+
+    unsigned long sector;
+
+    if ( !journal_is_ready() || (seq >= journal_seq) || (seq < journal_oldest_seq()) ) {
+        return 0;
+    }
+
+    // rekordy niepenego sektora koca dziennika - w kopii zapisanej z ostatnim rekordem
+    if ( (seq / JOURNAL_RECORDS_PER_SECTOR) == (journal_seq / JOURNAL_RECORDS_PER_SECTOR) ) {
+        sector = journal_shadow_sector((journal_seq - 1) % JOURNAL_RECORDS_PER_SECTOR);
+    }
+    else {
+        sector = journal_first_sector + (seq / JOURNAL_RECORDS_PER_SECTOR) % journal_sectors;
+    }
+
+    // odczytaj tylko jeden rekord sektora
+    if ( !sd_read_part(sector, (seq % JOURNAL_RECORDS_PER_SECTOR) * JOURNAL_RECORD_SIZE, (unsigned char*)rec, JOURNAL_RECORD_SIZE) ) {
+        return 0;
+    }
+
+    return (rec->seq == seq) && (rec->crc == journal_crc(rec));
+}
+
+unsigned long journal_oldest_seq() {
+
+    // sektory skasowane z wyprzedzeniem nie zawieraj ju rekordw
+    unsigned long capacity = (journal_sectors - 2*JOURNAL_ERASE_AHEAD) * JOURNAL_RECORDS_PER_SECTOR;
+
+    return (journal_seq > capacity) ? (journal_seq - capacity) : 0;
+}
+
+unsigned long journal_find(unsigned long ts) {
+
+    unsigned long oldest, lo, hi, mid, start;
+    unsigned long first, last, bound;
+
+    if (journal_seq == 0) {
+        return 0;
+    }
+
+    // zakres sektorw z rekordami (ostatni moe by niepeny)
+    oldest = journal_oldest_seq() / JOURNAL_RECORDS_PER_SECTOR;
+    lo = oldest;
+    hi = (journal_seq - 1) / JOURNAL_RECORDS_PER_SECTOR;
+
+    // ramki zada o rnych okresach przeplataj si, wic czasy sektorw rosn tylko w przyblieniu -
+    // wyszukiwanie binarne wskazuje jedynie okolic pierwszego sektora z prbkami nie starszymi ni <ts>
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+
+        if ( !journal_sector_times(mid, &first, &last, &bound) || (last < ts) ) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    // przegldaj wczeniejsze sektory - dopki rekordy sektora mogy zosta zapisane po <ts>,
+    // sektor lub jego poprzednicy mog zawiera nowsze prbki (ramki innych zada)
+    start = lo;
+
+    while (lo > oldest) {
+        lo--;
+
+        if ( !journal_sector_times(lo, &first, &last, &bound) ) {
+            continue;
+        }
+
+        // wszystkie rekordy sektora i wczeniejszych zapisano przed <ts>
+        if (bound < ts) {
+            break;
+        }
+
+        if (last >= ts) {
+            start = lo;
+        }
+    }
+
+    return (start * JOURNAL_RECORDS_PER_SECTOR < journal_oldest_seq()) ? journal_oldest_seq() : start * JOURNAL_RECORDS_PER_SECTOR;
+}
+
+unsigned char journal_index_write(unsigned long sector) {
+
+    unsigned long first = 0xffffffff, last = 0;
+    unsigned int interval = 0;
+    unsigned long index;
+    unsigned char slot;
+
+    journal_record* rec;
+    journal_index* entry;
+
+    if ( !journal_index_ready ) {
+        return 0;
+    }
+
+    // zakres czasu prbek sektora (sektor nadal w buforze)
+    for (slot = 0; slot < JOURNAL_RECORDS_PER_SECTOR; slot++) {
+        rec = (journal_record*) (journal_buf + slot*JOURNAL_RECORD_SIZE);
+
+        if (rec->count == 0) {
+            continue;
+        }
+
+        if (rec->timestamp < first) first = rec->timestamp;
+        if (journal_record_last(rec) > last) last = journal_record_last(rec);
+        if (rec->interval > interval) interval = rec->interval;
+    }
+
+    // wpis indeksu - pozycja wg miejsca sektora w piercieniu
+    index = sector % journal_sectors;
+
+    if ( !sd_read_block(JOURNAL_INDEX_FIRST_SECTOR + index / JOURNAL_INDEX_PER_SECTOR, journal_buf) ) {
+        return 0;
+    }
+
+    entry = (journal_index*) (journal_buf + (index % JOURNAL_INDEX_PER_SECTOR) * JOURNAL_INDEX_SIZE);
+
+    memset((void*)entry, 0, JOURNAL_INDEX_SIZE);
+
+    entry->sector = sector;
+    entry->first  = first;
+    entry->last   = last;
+    entry->interval = interval;
+    entry->crc    = journal_index_crc(entry);
+
+    return sd_write_block(JOURNAL_INDEX_FIRST_SECTOR + index / JOURNAL_INDEX_PER_SECTOR, journal_buf);
+}
+
+unsigned char journal_sector_times(unsigned long sector, unsigned long* first, unsigned long* last, unsigned long* bound) {
+
+    unsigned long index = sector % journal_sectors;
+    unsigned long seq;
+
+    journal_index entry;
+    journal_record rec;
+
+    // wpis indeksu dotyczcy biecego "okrenia" piercienia
+    if ( journal_index_ready && sd_read_part(JOURNAL_INDEX_FIRST_SECTOR + index / JOURNAL_INDEX_PER_SECTOR, (index % JOURNAL_INDEX_PER_SECTOR) * JOURNAL_INDEX_SIZE, (unsigned char*)&entry, JOURNAL_INDEX_SIZE) ) {
+        if ( (entry.sector == sector) && (entry.crc == journal_index_crc(&entry)) ) {
+            *first = entry.first;
+            *last  = entry.last;
+            *bound = entry.last + entry.interval;
+            return 1;
+        }
+    }
+
+    // brak wpisu (sektor niepeny lub indeks niedostpny) - przejrzyj rekordy sektora
+    *first = 0xffffffff;
+    *last  = *bound = 0;
+
+    for (seq = sector * JOURNAL_RECORDS_PER_SECTOR; (seq < (sector + 1) * JOURNAL_RECORDS_PER_SECTOR) && (seq < journal_seq); seq++) {
+        if ( !journal_read(seq, &rec) ) {
+            continue;
+        }
+
+        if (rec.timestamp < *first) *first = rec.timestamp;
+        if (journal_record_last(&rec) > *last) *last = journal_record_last(&rec);
+        if (journal_record_last(&rec) + rec.interval > *bound) *bound = journal_record_last(&rec) + rec.interval;
+    }
+
+    return (*bound > 0);
+}
+
+unsigned char journal_sector_seq(unsigned long sector, unsigned long* seq) {
+
+    journal_record rec;
+
+    if ( !sd_read_part(journal_first_sector + sector, 0, (unsigned char*)&rec, JOURNAL_RECORD_SIZE) ) {
+        return 0;
+    }
+
+    // rekord musi by poprawny i lee na swoim miejscu w piercieniu
+    if ( (rec.crc != journal_crc(&rec)) || (rec.seq % JOURNAL_RECORDS_PER_SECTOR) || ((rec.seq / JOURNAL_RECORDS_PER_SECTOR) % journal_sectors != sector) ) {
+        return 0;
+    }
+
+    *seq = rec.seq;
+
+    return 1;
+}
+
+unsigned int journal_crc(journal_record* rec) {
+
+    unsigned int crc = 0xffff;
+    unsigned char i;
+
+    for (i = 0; i < JOURNAL_RECORD_SIZE - sizeof(unsigned int); i++) {
+        crc = _crc_ccitt_update(crc, ((unsigned char*)rec)[i]);
+    }
+
+    return crc;
+}
+
+unsigned int journal_index_crc(journal_index* entry) {
+
+    unsigned int crc = 0xffff;
+    unsigned char i;
+
+    for (i = 0; i < JOURNAL_INDEX_SIZE - sizeof(unsigned int); i++) {
+        crc = _crc_ccitt_update(crc, ((unsigned char*)entry)[i]);
+    }
+
+    return crc;
+}
+
+
+//
+// kodowanie prbek (delta-of-delta)
+//
+
+void journal_frame_init(journal_frame* frame, unsigned char mask, unsigned int interval, signed int* state) {
+
+    memset((void*)frame, 0, sizeof(journal_frame));
+
+    frame->rec.mask     = mask;
+    frame->rec.interval = interval;
+    frame->state        = state;
+}
+
+unsigned char journal_frame_add_at(journal_frame* frame, signed int* values, unsigned long timestamp) {
+
+    unsigned char ch, n, bits;
+    signed int delta;
+    time_t time;
+
+    // policz bity potrzebne na prbk wszystkich kanaw z maski
+    for (ch = 0, n = 0, bits = 0; ch < DS_DEVICES_MAX; ch++) {
+        if (frame->rec.mask & (1 << ch)) {
+            bits += (frame->rec.count == 0) ? 16 : journal_code_bits(values[ch] - frame->state[2*n] - frame->state[2*n+1]);
+            n++;
+        }
+    }
+
+    // prbka nie zmieci si w ramce - zapisz ramk i rozpocznij kolejn
+    if ( (frame->rec.count > 0) && (frame->bits + bits > JOURNAL_FRAME_BYTES*8) ) {
+        journal_frame_flush(frame);
+    }
+
+    // pierwsza prbka ramki - czas ramki (domylnie biecy czas z RTC)
+    if (frame->rec.count == 0) {
+        if (timestamp == 0) {
+            ds1306_time_get(&time);
+            timestamp = mktime(&time);
+        }
+
+        frame->rec.timestamp = timestamp;
+    }
+
+    for (ch = 0, n = 0; ch < DS_DEVICES_MAX; ch++) {
+
+        if ( !(frame->rec.mask & (1 << ch)) ) {
+            continue;
+        }
+
+        if (frame->rec.count == 0) {
+            // pena warto
+            journal_put_bits(frame, values[ch], 16);
+            frame->state[2*n+1] = 0;
+        }
+        else {
+            delta = values[ch] - frame->state[2*n];
+
+            // rnica delt w kodzie zig-zag (0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...)
+            unsigned int zz = ((delta - frame->state[2*n+1]) << 1) ^ ((delta - frame->state[2*n+1]) >> 15);
+
+            if (zz == 0) {
+                journal_put_bits(frame, 0b0, 1);
+            }
+            else if (zz <= 8) {
+                journal_put_bits(frame, 0b10, 2);
+                journal_put_bits(frame, zz - 1, 3);
+            }
+            else if (zz <= 128) {
+                journal_put_bits(frame, 0b110, 3);
+                journal_put_bits(frame, zz - 1, 7);
+            }
+            else {
+                journal_put_bits(frame, 0b111, 3);
+                journal_put_bits(frame, values[ch], 16);
+            }
+
+            frame->state[2*n+1] = delta;
+        }
+
+        frame->state[2*n] = values[ch];
+        n++;
+    }
+
+    frame->rec.count++;
+
+    // ogranicz liczb prbek w ramce (tyle mona straci przy zaniku zasilania)
+    if (frame->rec.count >= JOURNAL_FRAME_SAMPLES) {
+        return journal_frame_flush(frame);
+    }
+
+    return 1;
+}
+
+unsigned char journal_frame_flush(journal_frame* frame) {
+
+    unsigned long seq;
+
+    if (frame->rec.count == 0) {
+        return 1;
+    }
+
+    seq = journal_append(&(frame->rec));
+
+    // rozpocznij now ramk (wartoci i przyrosty kanaw pozostaj do kolejnego kodowania)
+    frame->rec.count = 0;
+    frame->bits = 0;
+    memset((void*)frame->rec.data, 0, JOURNAL_FRAME_BYTES);
+
+    return seq != JOURNAL_SEQ_NONE;
+}
+
+void journal_cursor_init(journal_cursor* cur, unsigned long seq, unsigned char ch) {
+
+    memset((void*)cur, 0, sizeof(journal_cursor));
+
+    cur->seq = seq;
+    cur->ch  = ch;
+}
+
+unsigned char journal_cursor_next(journal_cursor* cur, signed int* value, unsigned long* timestamp) {
+
+    unsigned char ch;
+    signed int val;
+    unsigned int zz;
+
+    // koniec ramki - szukaj kolejnej z danym kanaem
+    while (cur->sample >= cur->rec.count || !(cur->rec.mask & (1 << cur->ch)) || (cur->mask && cur->rec.mask != cur->mask) || (cur->interval && cur->rec.interval != cur->interval) ) {
+
+        // pomi rekordy starsze ni dostpne w dzienniku
+        if (cur->seq < journal_oldest_seq()) {
+            cur->seq = journal_oldest_seq();
+        }
+
+        if (cur->seq >= journal_seq) {
+            return 0;
+        }
+
+        if ( !journal_read(cur->seq++, &(cur->rec)) ) {
+            cur->rec.count = 0;
+        }
+
+        cur->sample = 0;
+        cur->bit    = 0;
+    }
+
+    // dekoduj prbk wszystkich kanaw ramki, zapamitaj dany
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+
+        if ( !(cur->rec.mask & (1 << ch)) ) {
+            continue;
+        }
+
+        if (cur->sample == 0) {
+            val = journal_get_bits(cur, 16);
+
+            if (ch == cur->ch) {
+                cur->value = val;
+                cur->delta = 0;
+            }
+        }
+        else if ( journal_get_bits(cur, 1) == 0 ) {
+            if (ch == cur->ch) {
+                cur->value += cur->delta;
+            }
+        }
+        else if ( journal_get_bits(cur, 1) == 0 ) {
+            zz = journal_get_bits(cur, 3) + 1;
+
+            if (ch == cur->ch) {
+                cur->delta += (zz & 1) ? -(signed int)((zz + 1) >> 1) : (signed int)(zz >> 1);
+                cur->value += cur->delta;
+            }
+        }
+        else if ( journal_get_bits(cur, 1) == 0 ) {
+            zz = journal_get_bits(cur, 7) + 1;
+
+            if (ch == cur->ch) {
+                cur->delta += (zz & 1) ? -(signed int)((zz + 1) >> 1) : (signed int)(zz >> 1);
+                cur->value += cur->delta;
+            }
+        }
+        else {
+            val = journal_get_bits(cur, 16);
+
+            if (ch == cur->ch) {
+                cur->delta = val - cur->value;
+                cur->value = val;
+            }
+        }
+    }
+
+    *value = cur->value;
+
+    if (timestamp) {
+        *timestamp = cur->rec.timestamp + (unsigned long)cur->sample * cur->rec.interval;
+    }
+
+    cur->sample++;
+
+    return 1;
+}
+
+unsigned char journal_cursor_past(journal_cursor* cur, unsigned long ts) {
+
+    unsigned long first, last, bound;
+
+    // kolejne prbki ramki s jeszcze pniejsze
+    cur->sample = cur->rec.count;
+
+    return journal_sector_times(cur->rec.seq / JOURNAL_RECORDS_PER_SECTOR, &first, &last, &bound) && (first > ts);
+}
+
+void journal_put_bits(journal_frame* frame, unsigned int value, unsigned char bits) {
+
+    while (bits--) {
+        if (value & (1 << bits)) {
+            frame->rec.data[frame->bits >> 3] |= 0x80 >> (frame->bits & 7);
+        }
+
+        frame->bits++;
+    }
+}
+
+unsigned int journal_get_bits(journal_cursor* cur, unsigned char bits) {
+
+    unsigned int value = 0;
+
+    while (bits--) {
+        value <<= 1;
+
+        if ( (cur->bit < JOURNAL_FRAME_BYTES*8) && (cur->rec.data[cur->bit >> 3] & (0x80 >> (cur->bit & 7))) ) {
+            value |= 1;
+        }
+
+        cur->bit++;
+    }
+
+    return value;
+}
+
+unsigned char journal_code_bits(signed int dod) {
+
+    unsigned int zz = (dod << 1) ^ (dod >> 15);
+
+    if (zz == 0)    return 1;
+    if (zz <= 8)    return 2 + 3;
+    if (zz <= 128)  return 3 + 7;
+
+    return 3 + 16;
+}
@@ -0,0 +1,176 @@
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#include "../telemetry.h"
+
+//
+// dziennik pomiarw - zapis wycznie sekwencyjny (append-only) w piercieniu sektorw karty SD
+//
+// rekord o numerze <seq> ley zawsze w sektorze (seq / JOURNAL_RECORDS_PER_SECTOR) % journal_sectors
+// na pozycji seq % JOURNAL_RECORDS_PER_SECTOR - po restarcie koniec dziennika
+// odnajdywany jest wyszukiwaniem binarnym po numerach sekwencyjnych pierwszych rekordw sektorw
+//
+// sektor piercienia zapisywany jest tylko raz - po zapenieniu; niepeny sektor koca dziennika
+// zapisywany jest na przemian do dwch sektorw kopii (rekord nieparzysty / parzysty), wic
+// przerwany zapis niszczy najwyej dopisywany rekord, a nie wczeniej zapisane rekordy sektora
+//
+// rekord to ramka kolejnych prbek kanaw z maski kodowanych rnic drugiego rzdu (delta-of-delta):
+// pierwsza prbka ramki - 16 bitw wartoci, kolejne - kod prefiksowy wartoci zig-zag rnicy delt:
+//
+//   0                  rnica delt = 0
+//   10  + 3 bity       |rnica| <= 4
+//   110 + 7 bitw      |rnica| <= 64
+//   111 + 16 bitw     pena warto prbki
+//
+
+// rozmiar pojedynczego rekordu
+#define JOURNAL_RECORD_SIZE         32
+#define JOURNAL_RECORDS_PER_SECTOR  (512 / JOURNAL_RECORD_SIZE)
+
+// brak rekordu / bd zapisu
+#define JOURNAL_SEQ_NONE            0xFFFFFFFF
+
+// sektory kopii niepenego sektora koca dziennika (na pocztku obszaru dziennika, przed piercieniem)
+#define JOURNAL_SHADOW_SECTORS      2
+
+// rozmiar danych ramki (bajty)
+#define JOURNAL_FRAME_BYTES         18
+
+// pojedynczy rekord dziennika (ramka prbek)
+typedef struct {
+    unsigned long seq;                  // numer sekwencyjny rekordu
+    unsigned long timestamp;            // czas pierwszej prbki ramki (sekundy od 1970 roku wg zegara DS1306)
+    unsigned char mask;                 // maska kanaw zapisanych w ramce
+    unsigned char count;                // liczba prbek (kada dla wszystkich kanaw z maski)
+    unsigned int  interval;             // odstp midzy prbkami (s)
+    unsigned char data[JOURNAL_FRAME_BYTES]; // strumie bitw prbek (warto 227 odpowiada 22.7C)
+    unsigned int  crc;                  // CRC16 (CCITT) poprzedzajcych pl rekordu
+} journal_record; // 4 + 4 + 1 + 1 + 2 + 18 + 2 = 32
+
+// wpis indeksu czasowego - zakres czasu prbek zapisanych w jednym sektorze dziennika
+typedef struct {
+    unsigned long sector;               // numer sektora liczony od pocztku dziennika (seq / JOURNAL_RECORDS_PER_SECTOR)
+    unsigned long first;                // czas najwczeniejszej prbki sektora
+    unsigned long last;                 // czas najpniejszej prbki sektora
+    unsigned int  interval;             // najduszy okres prbkowania ramek sektora
+    unsigned int  crc;                  // CRC16 (CCITT) poprzedzajcych pl
+} journal_index; // 4 + 4 + 4 + 2 + 2 = 16
+
+#define JOURNAL_INDEX_SIZE          16
+#define JOURNAL_INDEX_PER_SECTOR    (512 / JOURNAL_INDEX_SIZE)
+
+// koder ramki (jeden na zadanie akwizycji)
+typedef struct {
+    journal_record rec;                 // budowana ramka
+    unsigned char  bits;                // liczba zajtych bitw rec.data
+    signed int*    state;               // ostatnie wartoci i przyrosty kolejnych kanaw z maski (2 na kana, bufor wywoujcego)
+} journal_frame;
+
+// dekoder - odczyt kolejnych prbek jednego kanau
+typedef struct {
+    journal_record rec;                 // bieca ramka
+    unsigned long  seq;                 // numer kolejnego rekordu do odczytu
+    unsigned char  ch;                  // kana
+    unsigned char  mask;                // czytaj tylko ramki o tej masce kanaw (0 - dowolne)
+    unsigned int   interval;            // i tym okresie prbkowania (0 - dowolny)
+    unsigned char  sample;              // numer kolejnej prbki w ramce
+    unsigned char  bit;                 // pozycja w strumieniu bitw ramki
+    signed int     value;               // ostatnia warto kanau
+    signed int     delta;               // i jej przyrost
+} journal_cursor;
+
+// bufor na operacje I/O (sektor zapisywanego koca dziennika)
+unsigned char* journal_buf;
+
+// obszar karty zajmowany przez dziennik
+unsigned long journal_first_sector;
+unsigned long journal_sectors;
+
+// numer sekwencyjny kolejnego rekordu do zapisu
+unsigned long journal_seq;
+
+// czy na karcie jest miejsce na indeks czasowy?
+unsigned char journal_index_ready;
+
+// inicjalizacja dziennika - wyznaczenie obszaru na karcie, odtworzenie koca dziennika
+unsigned char journal_init(unsigned char*);
+
+// dopisz rekord (nadaje numer sekwencyjny i CRC; zwraca numer lub JOURNAL_SEQ_NONE)
+unsigned long journal_append(journal_record*);
+
+// odczytaj i sprawd rekord o podanym numerze sekwencyjnym
+unsigned char journal_read(unsigned long, journal_record*);
+
+// rozpocznij ramk prbek kanaw z maski pobieranych co <interval> sekund (bufor stanu kodera: 2 x liczba kanaw)
+void journal_frame_init(journal_frame*, unsigned char, unsigned int, signed int*);
+
+// dodaj prbk (tablica wartoci wszystkich kanaw) - pena ramka trafia do dziennika
+unsigned char journal_frame_add_at(journal_frame*, signed int*, unsigned long);
+
+// j.w. - prbka z biec chwil (RTC)
+#define journal_frame_add(frame, values)    journal_frame_add_at((frame), (values), 0)
+
+// zapisz niepen ramk do dziennika
+unsigned char journal_frame_flush(journal_frame*);
+
+// ustaw dekoder na rekord <seq> i kana <ch>
+void journal_cursor_init(journal_cursor*, unsigned long, unsigned char);
+
+// odczytaj kolejn prbk kanau (warto, czas) - zwraca 0 na kocu dziennika
+unsigned char journal_cursor_next(journal_cursor*, signed int*, unsigned long*);
+
+// odczytana prbka pniejsza ni koniec zakresu: pomi reszt ramki - zwraca 1, gdy odczyt mona
+// zakoczy (wszystkie ramki sektora zaczynaj si po kocu zakresu); wczeniej ramki innych zada
+// zapisane po ramkach z pniejszymi prbkami mog jeszcze zawiera prbki z zakresu
+unsigned char journal_cursor_past(journal_cursor*, unsigned long);
+
+// numer najstarszego rekordu dostpnego w dzienniku
+unsigned long journal_oldest_seq();
+
+// numer rekordu, od ktrego naley zacz odczyt prbek nie starszych ni podany czas
+unsigned long journal_find(unsigned long);
+
+// ustaw dekoder kanau na okolic podanego czasu (wczeniejsze prbki naley pomin)
+#define journal_cursor_seek(cur, ch, ts)    journal_cursor_init((cur), journal_find(ts), (ch))
+
+// czy dziennik jest dostpny?
+#define journal_is_ready()      ( journal_sectors > 0 )
+
+//
+// funkcje wewntrzne
+//
+
+// odczytaj numer sekwencyjny pierwszego rekordu sektora (o ile rekord jest poprawny)
+unsigned char journal_sector_seq(unsigned long, unsigned long*);
+
+// sektor karty z kopi niepenego sektora koca dziennika zawierajc rekordy do pozycji <slot> wcznie
+#define journal_shadow_sector(slot)     ( JOURNAL_FIRST_SECTOR + ((slot) % JOURNAL_SHADOW_SECTORS) )
+
+// odtwrz rekordy niepenego sektora koca dziennika z sektorw kopii
+void journal_shadow_recover();
+
+// suma kontrolna rekordu
+unsigned int journal_crc(journal_record*);
+
+// czas ostatniej prbki ramki
+#define journal_record_last(rec)    ( (rec)->timestamp + (unsigned long)((rec)->count - 1) * (rec)->interval )
+
+// zapisz wpis indeksu dla penego sektora dziennika (zawarto sektora w journal_buf)
+unsigned char journal_index_write(unsigned long);
+
+// czas najwczeniejszej i najpniejszej prbki w sektorze dziennika oraz grne ograniczenie chwili zapisu
+// jego rekordw (ramka trafia do dziennika najpniej jeden okres po swojej ostatniej prbce) - zwraca 0,
+// gdy sektor jest nieczytelny
+unsigned char journal_sector_times(unsigned long, unsigned long*, unsigned long*, unsigned long*);
+
+// suma kontrolna wpisu indeksu
+unsigned int journal_index_crc(journal_index*);
+
+// zapis / odczyt bitw strumienia ramki (od najstarszego bitu)
+void journal_put_bits(journal_frame*, unsigned int, unsigned char);
+unsigned int journal_get_bits(journal_cursor*, unsigned char);
+
+// liczba bitw kodu rnicy delt
+unsigned char journal_code_bits(signed int);
+
+#endif
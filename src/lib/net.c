@@ -43,7 +43,7 @@ uint32_t htonl(uint32_t val)
 void net_dump_eth_packet(ethernet_packet* packet, uint16_t len)
 {
     // ogranicz wielkosc pakietu
-    len = (ENC28_MAX_FRAMELEN < len) ? ENC28_MAX_FRAMELEN : len;
+    len = (NET_PACKET_LEN < len) ? NET_PACKET_LEN : len;
 
     rs_newline();
     rs_text_P(PSTR("Packet dump (")); rs_int(len); 
@@ -247,7 +247,7 @@ uint16_t net_make_tcp_packet(tcp_packet* tcp, uint8_t flags, uint16_t src_port,
 
     tcp->seq_num = ack_num;
 
-    tcp->options = 0x80050402; // opcje: max. rozmiar segmentu danych: 1408 bajtow
+    tcp->options = NET_TCP_OPTIONS; // opcje: max. rozmiar segmentu danych (NET_TCP_MSS)
     
     // !!! suma kontrolna liczona w funkcji obslugi "wyzszego" pakietu IP
     tcp->checksum = 0;
@@ -284,7 +284,7 @@ void net_tcp_synchronize(tcp_packet* tcp, ethernet_packet* eth)
     tcp->window_size = HTONS(5840);
     tcp->hlen = 0x60; /* (24/4) << 4 */
 
-    tcp->options = 0x80050402; // opcje: max. rozmiar segmentu danych: 1408 bajtow
+    tcp->options = NET_TCP_OPTIONS; // opcje: max. rozmiar segmentu danych (NET_TCP_MSS)
 
     // zloz pakiety
     len = net_make_ip_packet(ip, NET_IP_TCP, (uint8_t*) tcp, ip->src_addr, 24);
@@ -324,7 +324,7 @@ void net_tcp_acknowledge(tcp_packet* tcp, ethernet_packet* eth)
     tcp->window_size = HTONS(5840);
     tcp->hlen = 0x60; /* (24/4) << 4 */
 
-    tcp->options = 0x80050402; // opcje: max. rozmiar segmentu danych: 1408 bajtow
+    tcp->options = NET_TCP_OPTIONS; // opcje: max. rozmiar segmentu danych (NET_TCP_MSS)
 
     // zloz pakiety
     len = net_make_ip_packet(ip, NET_IP_TCP, (uint8_t*) tcp, ip->src_addr, 24);
@@ -345,14 +345,19 @@ void net_tcp_acknowledge(tcp_packet* tcp, ethernet_packet* eth)
 }
 
 // -----------------------------------------------------------------------------------------
-// wpisz dane do pakietu TCP z podanym offset / zwrocony zostanie nowy offset + kontrola bufora
+// wpisz dane do pakietu TCP z podanym offset / zwrocony zostanie nowy offset
+// (pelny segment jest wysylany, a dane wpisywane od poczatku)
 
 uint16_t net_tcp_write_data_P(tcp_packet* tcp, uint16_t offset, PGM_P data)
 {
     uint16_t len = offset;
     unsigned char c;
-  	while ( (c = pgm_read_byte(data++)) && (len < ENC28_MAX_FRAMELEN) )
+  	while ( (c = pgm_read_byte(data++)) ) {
+        if (len >= NET_TCP_DATA_MAX)
+            len = net_tcp_flush(tcp, len, NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK);
+
     	tcp->data[len++] = c;
+    }
 
     return len;
 }
@@ -361,12 +366,52 @@ uint16_t net_tcp_write_data(tcp_packet* tcp, uint16_t offset, unsigned char* dat
 {
     uint16_t len = offset;
     unsigned char c;
-  	while ( (c = *(data++)) && (len < ENC28_MAX_FRAMELEN) )
+  	while ( (c = *(data++)) ) {
+        if (len >= NET_TCP_DATA_MAX)
+            len = net_tcp_flush(tcp, len, NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK);
+
     	tcp->data[len++] = c;
+    }
 
     return len;
 }
 
+// -----------------------------------------------------------------------------------------
+// wyslij dane odpowiedzi jako kolejny segment TCP - pierwszy skladany z odebranego pakietu
+// (zamiana adresow, portow i numerow), kolejne z numerem sekwencji przesunietym o wyslane dane
+
+uint16_t net_tcp_flush(tcp_packet* tcp, uint16_t len, uint8_t flags)
+{
+    ethernet_packet *eth = (ethernet_packet*) net_packet;
+    ip_packet       *ip  = (ip_packet*) (eth->data);
+    uint16_t size;
+
+    if (!net_tcp_sending) {
+        size = net_make_tcp_packet(tcp, flags, HTONS(tcp->dest_port), HTONS(tcp->src_port), NULL, len);
+        size = net_make_ip_packet(ip, NET_IP_TCP, (uint8_t*) tcp, ip->src_addr, size);
+        size = net_make_eth_packet(eth, (uint8_t*) ip, eth->src, size);
+    }
+    else {
+        tcp->flags = flags;
+
+        size = net_make_ip_packet(ip, NET_IP_TCP, (uint8_t*) tcp, ip->dest_addr, 24 + len);
+        size = net_make_eth_packet(eth, (uint8_t*) ip, eth->dest, size);
+    }
+
+    enc28_packet_send((uint8_t*)eth, size);
+
+    // ostatni segment konczy odpowiedz
+    if (flags & NET_TCP_FLAG_FIN) {
+        net_tcp_sending = 0;
+    }
+    else {
+        net_tcp_sending = 1;
+        tcp->seq_num = htonl( htonl(tcp->seq_num) + len );
+    }
+
+    return 0;
+}
+
 
 // -----------------------------------------------------------------------------------------
 // wylij zapytanie ARP o podane IP
@@ -465,7 +510,7 @@ void net_dhcp_init(uint8_t* buf)
     unsigned char i;
 
     // czy bufor
-    memset((void*) buf, 0, ENC28_MAX_FRAMELEN);
+    memset((void*) buf, 0, NET_PACKET_LEN);
 
     // zeruj ustawienia bramy i maski sieciowej
     for (i=0; i<4; i++) {
@@ -701,6 +746,168 @@ void net_icmp_response(icmp_packet* icmp, ethernet_packet* eth)
     return;
 }
 
+// -----------------------------------------------------------------------------------------
+// IGMP
+void net_multicast_mac(uint8_t* ip, uint8_t* mac)
+{
+    mac[0] = 0x01;
+    mac[1] = 0x00;
+    mac[2] = 0x5e;
+    mac[3] = ip[1] & 0x7f;
+    mac[4] = ip[2];
+    mac[5] = ip[3];
+}
+
+void net_igmp_join(uint8_t* group)
+{
+    ip_addr all_hosts = {224, 0, 0, 1};
+    mac_addr mac;
+
+    if ( !net_is_multicast(group) ) {
+        return;
+    }
+
+    memcpy(net_igmp_group, group, sizeof(ip_addr));
+
+    // filtr odbiorczy ENC28: tylko zapytania routera (224.0.0.1) i ramki grupy
+    enc28_hash_clear();
+
+    net_multicast_mac(all_hosts, mac);
+    enc28_hash_add(mac);
+
+    net_multicast_mac(group, mac);
+    enc28_hash_add(mac);
+
+    // pierwsze zgoszenie w najbliszym takcie
+    net_igmp_timer = 1;
+    net_igmp_unsolicited = NET_IGMP_UNSOLICITED_REPORTS;
+
+    rs_text_P(PSTR("IGMP: grupa ")); net_dump_ip(group); rs_newline();
+}
+
+void net_igmp_leave(uint8_t* buf)
+{
+    ip_addr all_routers = {224, 0, 0, 2};
+
+    if ( !net_is_multicast(net_igmp_group) ) {
+        return;
+    }
+
+    net_igmp_send(buf, NET_IGMP_LEAVE, net_igmp_group, all_routers);
+
+    memset(net_igmp_group, 0, sizeof(ip_addr));
+    net_igmp_timer = 0;
+    net_igmp_unsolicited = 0;
+
+    enc28_hash_clear();
+}
+
+void net_igmp_send(uint8_t* buf, uint8_t type, uint8_t* group, uint8_t* dest)
+{
+    unsigned char i;
+    unsigned int len;
+    mac_addr mac;
+
+    // naglowek IP z opcja Router Alert (24 bajty)
+    ethernet_packet *eth  = (ethernet_packet*) buf;
+    ip_packet       *ip   = (ip_packet*) (eth->data);
+    igmp_packet     *igmp = (igmp_packet*) (ip->data + 4);
+
+    igmp->type     = type;
+    igmp->max_resp = 0;
+    memcpy(igmp->group, group, sizeof(ip_addr));
+
+    igmp->checksum = 0;
+    igmp->checksum = net_checksum((uint8_t*)igmp, sizeof(igmp_packet), 0);
+
+    for (i=0; i<4; i++) {
+        ip->dest_addr[i] = dest[i];
+        ip->src_addr[i]  = my_net_config.my_ip[i];
+    }
+
+    net_ip_packet_id++;
+
+    ip->ver_ihl      = 0x46;
+    ip->tos          = 0;
+    ip->length       = HTONS( (24 + sizeof(igmp_packet)) );
+    ip->id           = HTONS(net_ip_packet_id);
+    ip->flags_offset = 0;
+    ip->ttl          = 1;   // tylko sie lokalna
+    ip->proto        = NET_IP_IGMP;
+
+    // Router Alert (RFC 2113)
+    ip->data[0] = 0x94;
+    ip->data[1] = 0x04;
+    ip->data[2] = 0x00;
+    ip->data[3] = 0x00;
+
+    ip->checksum = 0;
+    ip->checksum = net_checksum((uint8_t*)ip, 24, 0);
+
+    // ramka na adres MAC grupy
+    net_multicast_mac(dest, mac);
+
+    len = net_make_eth_packet(eth, (uint8_t*) ip, mac, 24 + sizeof(igmp_packet));
+
+    eth->eth_type = HTONS(NET_IP4_FRAME);
+
+    enc28_packet_send((uint8_t*)eth, len);
+}
+
+void net_igmp_handle(igmp_packet* igmp)
+{
+    uint8_t delay;
+
+    if ( !net_is_multicast(net_igmp_group) ) {
+        return;
+    }
+
+    switch (igmp->type) {
+        // zapytanie oglne (grupa 0.0.0.0) lub o nasz grup - odpowiedz po losowym czasie z zakresu max_resp
+        case NET_IGMP_QUERY:
+            if ( igmp->group[0] && memcmp(igmp->group, net_igmp_group, sizeof(ip_addr)) ) {
+                break;
+            }
+
+            // IGMPv1: max_resp = 0 -> 10 s
+            delay = igmp->max_resp ? (igmp->max_resp / 10) : 10;
+            delay = 1 + ( delay ? (my_net_config.pktcnt % delay) : 0 );
+
+            if ( (net_igmp_timer == 0) || (net_igmp_timer > delay) ) {
+                net_igmp_timer = delay;
+            }
+            break;
+
+        // inny czonek grupy ju si zgosi - nasze zgoszenie zbdne
+        case NET_IGMP_REPORT_V1:
+        case NET_IGMP_REPORT_V2:
+            if ( !net_igmp_unsolicited && !memcmp(igmp->group, net_igmp_group, sizeof(ip_addr)) ) {
+                net_igmp_timer = 0;
+            }
+            break;
+    }
+}
+
+void net_igmp_pooling(uint8_t* buf)
+{
+    if ( (net_igmp_timer == 0) || (--net_igmp_timer > 0) ) {
+        return;
+    }
+
+    // brak adresu IP (DHCP) - sprbuj za sekund
+    if (my_net_config.my_ip[0] == 0) {
+        net_igmp_timer = 1;
+        return;
+    }
+
+    net_igmp_send(buf, NET_IGMP_REPORT_V2, net_igmp_group, net_igmp_group);
+
+    // kolejne zgoszenie po doczeniu do grupy
+    if ( net_igmp_unsolicited && --net_igmp_unsolicited ) {
+        net_igmp_timer = NET_IGMP_UNSOLICITED_INTERVAL;
+    }
+}
+
 // -----------------------------------------------------------------------------------------
 // NTP
 void net_ntp_get_time(uint8_t* buf)
@@ -826,6 +1033,25 @@ void gmtime(uint32_t timestamp,time_t* time)
     return;
 }
 
+// zamiana struktury czasu na liczb sekund od 1970 roku (odwrotno gmtime)
+uint32_t mktime(time_t* time)
+{
+    uint16_t year  = 2000 + time->tm_year;
+    uint16_t dayno = time->tm_mday - 1;
+    uint16_t y;
+    unsigned char mon;
+
+    for (y = NET_NTP_EPOCH_YEAR; y < year; y++) {
+        dayno += NET_NTP_YEARSIZE(y);
+    }
+
+    for (mon = 0; mon < time->tm_mon - 1; mon++) {
+        dayno += monthlen(NET_NTP_LEAPYEAR(year), mon);
+    }
+
+    return (uint32_t)dayno * NET_NTP_SECS_DAY + (uint32_t)time->tm_hour * 3600UL + time->tm_min * 60U + time->tm_sec;
+}
+
 // -----------------------------------------------------------------------------------------
 // mikro-stos TCP/IP
 unsigned char net_stack(ethernet_packet *eth_packet)
@@ -849,8 +1075,13 @@ unsigned char net_stack(ethernet_packet *eth_packet)
             // czy pakiet IP jest na pewno dla nas? (sprawdz IP)
             ip = (ip_packet*) (eth_packet->data);
 
+            // IGMP: zapytania routera (224.0.0.1 / adres grupy) i zgoszenia innych czonkw grupy
+            if ( (ip->proto == NET_IP_IGMP) && net_is_multicast(ip->dest_addr) ) {
+                net_igmp_handle( (igmp_packet*) (((unsigned char*) ip) + ((ip->ver_ihl & 0x0f) * 4)) );
+            }
+
             // parsuj pakiet IP w zaleznosci od jego typu
-            if ( net_is_my_ip(ip->dest_addr) ) {
+            else if ( net_is_my_ip(ip->dest_addr) ) {
                 // dane pakietu IP (przesuniecie wylicz z wartosci pola IHL naglowka razy 4)
                 unsigned char* ip_data = (((unsigned char*) ip) + ((ip->ver_ihl & 0x0f) * 4) );
 
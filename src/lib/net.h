@@ -25,6 +25,9 @@ net_config my_net_config;
 // licznik ID pakietow IP
 volatile uint16_t net_ip_packet_id;
 
+// biezaca odpowiedz TCP ma juz wyslane segmenty (net_tcp_flush)
+unsigned char net_tcp_sending;
+
 // -----------------------------------------------------------------------------------------
 // ramka Ethernet
 typedef struct
@@ -79,6 +82,7 @@ typedef struct
 
 // http://tools.ietf.org/html/rfc1700
 #define NET_IP_ICMP 0x01
+#define NET_IP_IGMP 0x02
 #define NET_IP_TCP  0x06
 #define NET_IP_UDP  0x11
 
@@ -109,6 +113,13 @@ typedef struct
 #define NET_TCP_FLAG_ECN    64
 #define NET_TCP_FLAG_CWR    128
 
+// max. rozmiar segmentu danych (bufor pakietow bez naglowkow Ethernet, IP i TCP z opcjami) i opcja MSS
+#define NET_TCP_MSS         (NET_PACKET_LEN - 14 - 20 - 24)
+#define NET_TCP_OPTIONS     ( 0x0402UL | ((unsigned long)(NET_TCP_MSS >> 8) << 16) | ((unsigned long)(NET_TCP_MSS & 0xff) << 24) )
+
+// segment wysylany po przekroczeniu (zapas na znaki wpisywane bezposrednio do tcp->data)
+#define NET_TCP_DATA_MAX    (NET_TCP_MSS - 32)
+
 
 // -----------------------------------------------------------------------------------------
 // UDP
@@ -137,6 +148,31 @@ typedef struct
 #define NET_ICMP_TYPE_ECHO_REPLY    0x00
 #define NET_ICMP_TYPE_ECHO_REQUEST  0x08
 
+// -----------------------------------------------------------------------------------------
+// IGMPv2 (RFC 2236)
+typedef struct
+{
+    uint8_t  type;
+    uint8_t  max_resp;      // maks. opnienie odpowiedzi na zapytanie (1/10 s)
+    uint16_t checksum;
+    ip_addr  group;
+} igmp_packet;
+
+#define NET_IGMP_QUERY              0x11
+#define NET_IGMP_REPORT_V1          0x12
+#define NET_IGMP_REPORT_V2          0x16
+#define NET_IGMP_LEAVE              0x17
+
+#define NET_IGMP_UNSOLICITED_REPORTS    2   // liczba zgosze po doczeniu do grupy
+#define NET_IGMP_UNSOLICITED_INTERVAL   10  // odstp midzy nimi (s)
+
+// grupa multicast, do ktrej naley urzdzenie (0.0.0.0 - brak)
+ip_addr net_igmp_group;
+
+// sekundy do wysania zgoszenia czonkostwa (0 - nic do wysania) / pozostae zgoszenia po doczeniu
+uint8_t net_igmp_timer;
+uint8_t net_igmp_unsolicited;
+
 
 // -----------------------------------------------------------------------------------------
 // DHCP
@@ -243,10 +279,13 @@ void net_tcp_synchronize(tcp_packet*, ethernet_packet*);
 // wyslij potwierdzenie otrzymania pakietu
 void net_tcp_acknowledge(tcp_packet*, ethernet_packet*);
 
-// wpisz dane do pakietu TCP
+// wpisz dane do pakietu TCP (po zapelnieniu segmentu wysyla go - net_tcp_flush)
 uint16_t net_tcp_write_data(tcp_packet*, uint16_t, unsigned char*);
 uint16_t net_tcp_write_data_P(tcp_packet*, uint16_t, PGM_P);
 
+// wyslij dane odpowiedzi TCP (w net_packet) jako kolejny segment z podanymi flagami - zwraca 0 (nowy offset)
+uint16_t net_tcp_flush(tcp_packet*, uint16_t, uint8_t);
+
 // -----------------------------------------------------------------------------------------
 // ARP
 
@@ -277,6 +316,28 @@ uint8_t  net_dhcp_option_get(uint8_t*, uint8_t, uint8_t, void*);
 // odpowiedz na ICMP (odpowiedz na PING)
 void net_icmp_response(icmp_packet*, ethernet_packet*);
 
+// -----------------------------------------------------------------------------------------
+// IGMP / multicast
+
+// adres IP z zakresu 224.0.0.0/4
+#define net_is_multicast(ip)    ( ((ip)[0] & 0xf0) == 0xe0 )
+
+// adres MAC grupy: 01:00:5e + 23 najmodsze bity adresu IP
+void net_multicast_mac(uint8_t*, uint8_t*);
+
+// docz do grupy (filtr ENC28 + zgoszenia czonkostwa) / opu grup
+void net_igmp_join(uint8_t*);
+void net_igmp_leave(uint8_t*);
+
+// wyslij komunikat IGMP (bufor, typ, grupa, adres docelowy)
+void net_igmp_send(uint8_t*, uint8_t, uint8_t*, uint8_t*);
+
+// obsluz zapytanie / zgoszenie innego hosta
+void net_igmp_handle(igmp_packet*);
+
+// wylij zaplanowane zgoszenie (co sekund)
+void net_igmp_pooling(uint8_t*);
+
 // -----------------------------------------------------------------------------------------
 // NTP
 
@@ -299,7 +360,8 @@ void net_ntp_handle_answer(ntp_packet*, void (*func)(time_t*));
 #define	NET_NTP_LEAPYEAR(year)	(!((year) % 4) && (((year) % 100) || !((year) % 400)))
 #define	NET_NTP_YEARSIZE(year)	(NET_NTP_LEAPYEAR(year) ? 366 : 365)
 
-void gmtime(uint32_t,time_t*); 
+void gmtime(uint32_t,time_t*);
+uint32_t mktime(time_t*); 
 
 // -----------------------------------------------------------------------------------------
 // mikro-stos TCP/IP
@@ -0,0 +1,85 @@
+#include "perf.h"
+
+#ifdef PERF
+
+const char perf_pwm_name[] PROGMEM =     "pwm";
+const char perf_pooling_name[] PROGMEM = "pooling";
+const char perf_ow_name[] PROGMEM =      "1wire";
+const char perf_int1_name[] PROGMEM =    "int1";
+const char perf_adc_name[] PROGMEM =     "adc";
+
+// kolejno wg PERF_*
+PGM_P const perf_isr_names[PERF_ISRS] PROGMEM = {perf_pwm_name, perf_pooling_name, perf_ow_name, perf_int1_name, perf_adc_name};
+
+void perf_clear() {
+
+    unsigned char n, sreg = SREG;
+
+    cli();
+
+    memset((void*) perf_records, 0, sizeof(perf_records));
+
+    for (n = 0; n < PERF_HANDLERS; n++) {
+        perf_records[n].min = 0xffff;
+    }
+
+    SREG = sreg;
+}
+
+void perf_get(unsigned char id, perf_record* rec) {
+
+    unsigned char sreg = SREG;
+
+    cli();
+    memcpy((void*) rec, (void*) &perf_records[id], sizeof(perf_record));
+    SREG = sreg;
+}
+
+void perf_add(unsigned char id, unsigned int latency, unsigned int exec) {
+
+    perf_record* rec = &perf_records[id];
+    unsigned char bin = 0;
+
+    // pierwszy przebieg wyznacza redni
+    rec->mean = (rec->min == 0xffff) ? exec : rec->mean - (rec->mean >> 3) + (exec >> 3);
+
+    if (exec < rec->min) {
+        rec->min = exec;
+    }
+
+    if (exec > rec->max) {
+        rec->max = exec;
+    }
+
+    // przedziay co potg czwrki
+    while ( (latency >>= 2) && (bin < PERF_BINS - 1) ) {
+        bin++;
+    }
+
+    if (rec->latency[bin] < 0xffff) {
+        rec->latency[bin]++;
+    }
+}
+
+unsigned int perf_time(unsigned int start) {
+
+    unsigned int now = TCNT1;
+
+    // licznik wyzerowany po dopasowaniu OCR1A (CTC)
+    if (now < start) {
+        now += OCR1A + 1;
+    }
+
+    return (now - start) >> 1;
+}
+
+PGM_P perf_name(unsigned char id) {
+
+    if (id < PERF_ISRS) {
+        return (PGM_P) pgm_read_word(&perf_isr_names[id]);
+    }
+
+    return sched_task_name(id - PERF_ISRS);
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _PERF_H
+#define _PERF_H
+
+#include "../telemetry.h"
+
+// pomiary czasw obsugi przerwa i zada planisty (PERF w telemetry.h) - znaczniki czasu z licznika Timer1 (0,5 us)
+//
+// opnienie startu: od zdarzenia (dopasowanie licznika / gotowo zadania) do wejcia do obsugi,
+// histogram w przedziaach < 4, 16, 64, 256, 1024, 4096, 16384 us i powyej
+#define PERF_BINS       8
+
+// obsugi przerwa
+#define PERF_PWM        0       // SIG_OUTPUT_COMPARE0 - sterownik PWM (opnienie z dokadnoci do taktu Timer0 - 64 us)
+#define PERF_POOLING    1       // SIG_OUTPUT_COMPARE1A - takt poolingu
+#define PERF_OW         2       // SIG_OUTPUT_COMPARE1B - szczeliny 1wire
+#define PERF_INT1       3       // SIG_INTERRUPT1 - ENC28 (bez pomiaru opnienia)
+#define PERF_ADC        4       // SIG_ADC (bez pomiaru opnienia)
+#define PERF_ISRS       5
+
+// zadania planisty
+#define PERF_TASK(n)    (PERF_ISRS + (n))
+
+#define PERF_HANDLERS   (PERF_ISRS + SCHED_TASKS_MAX)
+
+#ifdef PERF
+
+// statystyki obsugi (czasy w us)
+typedef struct
+{
+  unsigned int min;
+  unsigned int max;
+  unsigned int mean;                // rednia kroczca 1/8
+  unsigned int latency[PERF_BINS];  // histogram opnie startu
+} perf_record;
+
+perf_record perf_records[PERF_HANDLERS];
+
+// zeruj statystyki
+void perf_clear();
+
+// kopia statystyk obsugi <id> (rekordy zmieniane w przerwaniach)
+void perf_get(unsigned char, perf_record*);
+
+// dolicz przebieg obsugi <id> (opnienie startu, czas wykonania)
+void perf_add(unsigned char, unsigned int, unsigned int);
+
+// czas (us) od znacznika <start> (TCNT1) - w obrbie przerwania
+unsigned int perf_time(unsigned int);
+
+// nazwa obsugi
+PGM_P perf_name(unsigned char);
+
+// pocztek / koniec obsugi przerwania (opnienie startu w us wyznaczane na wejciu)
+#define perf_enter(latency)     unsigned int perf_start = TCNT1, perf_latency = (latency)
+#define perf_exit(id)           perf_add(id, perf_latency, perf_time(perf_start))
+
+#else
+
+#define perf_clear()
+#define perf_add(id, latency, exec)
+#define perf_enter(latency)
+#define perf_exit(id)
+
+#endif
+
+#endif
@@ -2,8 +2,8 @@
 
 void pid_init(pid_regulator* pid, unsigned int P, unsigned int I, unsigned int D) {
 
-    // zerowanie
-    pid->last_PV = 0;
+    // zerowanie (czon D od drugiego przebiegu)
+    pid->last_PV = PID_PV_NONE;
     pid->sum_e = 0L;
 
     // wart. wspolczynnikow
@@ -18,8 +18,8 @@ void pid_init(pid_regulator* pid, unsigned int P, unsigned int I, unsigned int D
 
 int pid_loop(pid_regulator* pid,int pv, int sp) {
 
-    int  error, p_term, d_term; // 16
-    long i_term, ret, temp;     // 32
+    int  error, p_term;                 // 16
+    long i_term, d_term, ret, temp;     // 32
 
     // oblicz uchyb
     error = sp - pv;
@@ -58,23 +58,33 @@ int pid_loop(pid_regulator* pid,int pv, int sp) {
     }
 
     //
-    // D
+    // D (pierwszy przebieg - PV z biecego pomiaru)
     //
-    d_term = pid->D * (pid->last_PV - pv);
+    if (pid->last_PV == PID_PV_NONE) {
+        pid->last_PV = pv;
+    }
+
+    d_term = (long) pid->D * (pid->last_PV - pv);
 
     pid->last_PV = pv;
 
     // oblicz wysterowanie na wyjsciu regulatora (wraz ze skalowaniem)
     ret = (p_term + i_term + d_term) / PID_SCALING_FACTOR;
 
-    // ograniczenia (+ antiwindup)
-    if (ret > INT16_MAX) {
-        ret = INT16_MAX;
-        pid->sum_e -= error;
+    // ograniczenia do zakresu wyjcia (+ antiwindup: nie cakuj uchybu pogbiajcego nasycenie)
+    if (ret > PID_OUTPUT_MAX) {
+        ret = PID_OUTPUT_MAX;
+
+        if (error > 0) {
+            pid->sum_e -= error;
+        }
     }
-    else if (ret < INT16_MIN) {
-        ret = INT16_MIN;
-        pid->sum_e -= error;
+    else if (ret < PID_OUTPUT_MIN) {
+        ret = PID_OUTPUT_MIN;
+
+        if (error < 0) {
+            pid->sum_e -= error;
+        }
     }
 
     return (int) ret;
@@ -98,3 +108,366 @@ void pid_dump(pid_regulator* pid) {
 
     rs_newline();
 }
+
+void pid_zones_init() {
+
+    unsigned char z;
+
+    for (z=0; z < PID_COUNT; z++) {
+        pid_init(&pid[z], my_config.pid_gains[z][0], my_config.pid_gains[z][1], my_config.pid_gains[z][2]);
+
+        memset((void*) &pid_zones[z], 0, sizeof(pid_zone));
+    }
+
+    memset((void*) &pid_tune, 0, sizeof(pid_tuner));
+    pid_tune.zone = 0xff;
+}
+
+unsigned char pid_zone_set(unsigned char z, char* def) {
+
+    unsigned int val[6];
+    unsigned char n = 0, sreg;
+
+    if (z >= PID_COUNT) {
+        return 0;
+    }
+
+    // wartoci kolejnych pl (pusta definicja - wycz stref)
+    while (def && *def && (n < 6)) {
+        val[n++] = atoi(def);
+
+        def = strchr(def, ',');
+        def = def ? def+1 : 0;
+    }
+
+    // bdna definicja nie zmienia ustawie strefy
+    if ( n && ( ((n != 3) && (n != 6)) || (val[0] >= DS_DEVICES_MAX) || (val[1] >= PWM_CHANNELS) ) ) {
+        return 0;
+    }
+
+    // nowe ustawienia przerywaj strojenie strefy (strojenie moe zakoczy si w przerwaniu - sprawdzenie
+    // i przerwanie niepodzielne)
+    sreg = SREG;
+    cli();
+
+    if (pid_tune.zone == z) {
+        pid_tune_stop(PID_TUNE_FAILED);
+    }
+
+    SREG = sreg;
+
+    // zwolnij kana PWM strefy - wyczona do czasu ustawienia regulatora (pomiary kocz si w przerwaniu)
+    if ( pid_zone_enabled(z) ) {
+        my_config.pid_sensor[z] = 0xff;
+        pwm_set_fill(my_config.pid_pwm[z], 0);
+    }
+
+    if (n == 0) {
+        my_config.pid_sensor[z] = 0xff;
+        config_changed = 1;
+
+        return 1;
+    }
+
+    my_config.pid_pwm[z]    = val[1];
+    my_config.pid_sp[z]     = (signed int) val[2];
+
+    if (n == 6) {
+        my_config.pid_gains[z][0] = val[3];
+        my_config.pid_gains[z][1] = val[4];
+        my_config.pid_gains[z][2] = val[5];
+    }
+
+    config_changed = 1;
+
+    // regulator od nowa (zerowany integrator i pomiary czasu)
+    pid_init(&pid[z], my_config.pid_gains[z][0], my_config.pid_gains[z][1], my_config.pid_gains[z][2]);
+
+    memset((void*) &pid_zones[z], 0, sizeof(pid_zone));
+
+    my_config.pid_sensor[z] = val[0];
+
+    return 1;
+}
+
+void pid_on_measure(unsigned char channels) {
+
+    unsigned char z, ch;
+#ifdef PERF
+    unsigned long now, delta, period;
+#endif
+    pid_zone* zone;
+
+    for (z=0; z < PID_COUNT; z++) {
+        if ( !pid_zone_enabled(z) ) {
+            continue;
+        }
+
+        ch   = my_config.pid_sensor[z];
+        zone = &pid_zones[z];
+
+        // czujnik strefy odczony - wycz wyjcie
+        if ( !(ds_present & (1 << ch)) ) {
+            if (pid_tune.zone == z) {
+                pid_tune_stop(PID_TUNE_FAILED);
+            }
+
+            zone->output = 0;
+            pwm_set_fill(my_config.pid_pwm[z], 0);
+            continue;
+        }
+
+        if ( !(channels & (1 << ch)) ) {
+            continue;
+        }
+
+        // strefa w trakcie strojenia - wyjcie sterowane przekanikowo
+        if (pid_tune.zone == z) {
+            pid_tune_step();
+            continue;
+        }
+
+#ifdef PERF
+        now = pooling_time_us();
+
+        // odchyka odstpu od okresu prbkowania kanau
+        if (zone->last) {
+            delta  = now - zone->last;
+            period = ds18b20_period(ch) * 25000UL;
+            delta  = (delta > period) ? delta - period : period - delta;
+
+            zone->jitter = (delta > 0xffff) ? 0xffff : delta;
+
+            if (zone->jitter > zone->jitter_max) {
+                zone->jitter_max = zone->jitter;
+            }
+        }
+
+        zone->last = now;
+#endif
+
+        // wyjcie regulatora w zakresie wypenienia PWM
+        zone->output = pid_loop(&pid[z], ds_temp[ch], my_config.pid_sp[z]);
+
+        pwm_set_fill(my_config.pid_pwm[z], zone->output);
+
+#ifdef PERF
+        zone->exec = pooling_time_us() - now;
+
+        if (zone->exec > zone->exec_max) {
+            zone->exec_max = zone->exec;
+        }
+#endif
+    }
+}
+
+unsigned char pid_tune_start(unsigned char z, char* def) {
+
+    char* pos;
+    unsigned char sreg;
+
+    if (!def || !*def) {
+        sreg = SREG;
+        cli();
+
+        pid_tune_stop(PID_TUNE_FAILED);
+
+        SREG = sreg;
+        return 1;
+    }
+
+    // jedna strefa naraz
+    if ( (z >= PID_COUNT) || !pid_zone_enabled(z) || (pid_tune.zone != 0xff) || ((def[0] != PID_TUNE_ZN) && (def[0] != PID_TUNE_TL)) || (def[1] != ',') ) {
+        return 0;
+    }
+
+    pid_tune.rule = def[0];
+    pid_tune.high = atoi(def+2);
+
+    pos = strchr(def+2, ',');
+    pid_tune.hyst = pos ? atoi(pos+1) : 0;
+
+    if (pid_tune.high == 0) {
+        return 0;
+    }
+
+    pid_tune.state   = PID_TUNE_RUNNING;
+    pid_tune.cycles  = 0;
+    pid_tune.last_on = 0;
+    pid_tune.sum_tu  = 0;
+    pid_tune.sum_a   = 0;
+    pid_tune.ku      = 0;
+    pid_tune.tu      = 0;
+    pid_tune.start   = uptime;
+
+    // pierwszy przebieg (kolejny pomiar strefy) ustawi przekanik wg PV
+    pid_tune.relay   = 0xff;
+    pid_tune.zone    = z;
+
+    rs_text_P(PSTR("PID: strojenie strefy #")); rs_int(z); rs_newline();
+
+    return 1;
+}
+
+void pid_tune_stop(unsigned char state) {
+
+    unsigned char z = pid_tune.zone;
+
+    // strojenie ju zakoczone (np. w przerwaniu)
+    if (z == 0xff) {
+        return;
+    }
+
+    pid_tune.zone  = 0xff;
+    pid_tune.state = state;
+
+    // regulator strefy od nowa (zerowany integrator)
+    pid_init(&pid[z], my_config.pid_gains[z][0], my_config.pid_gains[z][1], my_config.pid_gains[z][2]);
+
+    if (state == PID_TUNE_FAILED) {
+        pid_zones[z].output = 0;
+        pwm_set_fill(my_config.pid_pwm[z], 0);
+
+        rs_text_P(PSTR("PID: strojenie przerwane")); rs_newline();
+    }
+}
+
+void pid_tune_step() {
+
+    unsigned char z = pid_tune.zone;
+    signed int pv = ds_temp[ my_config.pid_sensor[z] ];
+    signed int sp = my_config.pid_sp[z];
+    unsigned long now = pooling_time_us();
+
+    if ( (uptime - pid_tune.start) > PID_TUNE_TIMEOUT ) {
+        pid_tune_stop(PID_TUNE_FAILED);
+        return;
+    }
+
+    if (pv > pid_tune.pv_max) {
+        pid_tune.pv_max = pv;
+    }
+
+    if (pv < pid_tune.pv_min) {
+        pid_tune.pv_min = pv;
+    }
+
+    // pierwszy przebieg
+    if (pid_tune.relay == 0xff) {
+        pid_tune.relay  = (pv < sp) ? 1 : 0;
+        pid_tune.pv_max = pv;
+        pid_tune.pv_min = pv;
+    }
+    // wycz powyej SP + h
+    else if ( pid_tune.relay && (pv > sp + pid_tune.hyst) ) {
+        pid_tune.relay = 0;
+    }
+    // zacz poniej SP - h: koniec penego okresu oscylacji
+    else if ( !pid_tune.relay && (pv < sp - pid_tune.hyst) ) {
+        pid_tune.relay = 1;
+
+        if (pid_tune.last_on) {
+            // pierwszy okres (stan przejciowy) pomijany
+            if (pid_tune.cycles) {
+                pid_tune.sum_tu += (now - pid_tune.last_on) / 1000;
+                pid_tune.sum_a  += (pid_tune.pv_max - pid_tune.pv_min) / 2;
+            }
+
+            pid_tune.cycles++;
+        }
+
+        pid_tune.last_on = now;
+        pid_tune.pv_max  = pv;
+        pid_tune.pv_min  = pv;
+
+        if (pid_tune.cycles > PID_TUNE_CYCLES) {
+            pid_tune_finish();
+            return;
+        }
+    }
+
+    pid_zones[z].output = pid_tune.relay ? pid_tune.high : 0;
+    pwm_set_fill(my_config.pid_pwm[z], pid_zones[z].output);
+}
+
+void pid_tune_finish() {
+
+    unsigned char z = pid_tune.zone;
+    unsigned long a, t, kp;
+    unsigned int* gains = my_config.pid_gains[z];
+
+    a = pid_tune.sum_a / PID_TUNE_CYCLES;
+    t = ds18b20_period( my_config.pid_sensor[z] ) * 25UL; // okres prbkowania (ms)
+
+    pid_tune.tu = pid_tune.sum_tu / PID_TUNE_CYCLES;
+
+    // oscylacje w granicach histerezy (szum) - brak wyniku
+    if ( (a <= pid_tune.hyst) || (pid_tune.tu == 0) ) {
+        pid_tune_stop(PID_TUNE_FAILED);
+        return;
+    }
+
+    // amplituda skorygowana o histerez: sqrt(a^2 - h^2) (pierwiastek cakowity bit po bicie)
+    {
+        unsigned long n = a * a - (unsigned long)pid_tune.hyst * pid_tune.hyst;
+        unsigned long root = 0, bit = 1UL << 30;
+
+        while (bit > n) {
+            bit >>= 2;
+        }
+
+        while (bit) {
+            if (n >= root + bit) {
+                n   -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+
+        a = root ? root : 1;
+    }
+
+    // Ku = 4d / (pi a), d = high / 2 -> x 128: 512 / pi ~ 163
+    pid_tune.ku = pid_tune_scale(163UL * pid_tune.high, 1, 2 * a);
+
+    if (pid_tune.rule == PID_TUNE_ZN) {
+        // Kp = 0,6 Ku, Ki = Kp T / Ti = 2 Kp T / Tu, Kd = Kp Td / T = Kp Tu / 8T
+        kp = pid_tune_scale(pid_tune.ku, 3, 5);
+
+        gains[1] = pid_tune_scale(kp, 2 * t, pid_tune.tu);
+        gains[2] = pid_tune_scale(kp, pid_tune.tu, 8 * t);
+    }
+    else {
+        // Kp = Ku / 2,2, Ki = Kp T / 2,2 Tu, Kd = Kp Tu / 6,3 T
+        kp = pid_tune_scale(pid_tune.ku, 5, 11);
+
+        gains[1] = pid_tune_scale(kp, 5 * t, 11 * pid_tune.tu);
+        gains[2] = pid_tune_scale(kp, 10 * pid_tune.tu, 63 * t);
+    }
+
+    gains[0] = kp;
+
+    config_changed = 1;
+
+    rs_text_P(PSTR("PID: Ku ")); rs_long(pid_tune.ku); rs_text_P(PSTR(" Tu ")); rs_long(pid_tune.tu);
+    rs_text_P(PSTR(" -> P")); rs_long(gains[0]); rs_text_P(PSTR(" I")); rs_long(gains[1]); rs_text_P(PSTR(" D")); rs_long(gains[2]);
+    rs_newline();
+
+    // strefa wraca do regulacji z nowymi nastawami
+    pid_tune_stop(PID_TUNE_DONE);
+}
+
+unsigned int pid_tune_scale(unsigned long a, unsigned long b, unsigned long c) {
+
+    // nasycenie na 0xfffe - pid_init() dzieli przez wzmocnienie + 1
+    if ( (b && (a > 0xffffffffUL / b)) || (c == 0) ) {
+        return 0xfffe;
+    }
+
+    a = (a * b) / c;
+
+    return (a > 0xfffe) ? 0xfffe : a;
+}
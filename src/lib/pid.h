@@ -6,10 +6,17 @@
 // wspolczynnik skalowania wsp. P, I, D
 #define PID_SCALING_FACTOR  128
 
+// zakres wyjcia regulatora (wypenienie PWM) - poza nim uchyb nie jest cakowany
+#define PID_OUTPUT_MIN      0
+#define PID_OUTPUT_MAX      255
+
+// brak poprzedniego pomiaru (pierwszy przebieg bez czonu D)
+#define PID_PV_NONE         INT16_MIN
+
 // regulator PID
 typedef struct
 {
-  int last_PV;      // ostatnia wartosc procesowa (PV)
+  int last_PV;      // ostatnia wartosc procesowa (PV, PID_PV_NONE - brak)
   long sum_e;       // calka po uchybie
   
   unsigned int P;   // P: wzmocnienie czesci proporcjonalnej
@@ -21,12 +28,67 @@ typedef struct
 
 } pid_regulator;
 
+// strefa regulacji: czujnik DS18B20 -> regulator PID -> kana PWM (ustawienia w my_config)
+// czasy w us (pooling_time_us)
+typedef struct
+{
+  int output;               // ostatnie wyjcie regulatora
+#ifdef PERF
+  unsigned long last;       // chwila ostatniego przebiegu (0 - brak)
+  unsigned int exec;        // czas wykonania ostatniego przebiegu
+  unsigned int exec_max;
+  unsigned int jitter;      // odchyka ostatniego odstpu midzy przebiegami od okresu prbkowania czujnika
+  unsigned int jitter_max;
+#endif
+} pid_zone;
+
+// strojenie regulatora strefy metod przekanikow (Astrom - Hagglund): wyjcie przeczane midzy
+// wypenieniem <high> a zerem przy PV poza SP +/- histereza, z kolejnych okresw oscylacji
+// amplituda a i okres Tu -> Ku = 4d / (pi * sqrt(a^2 - h^2)), d = high / 2 -> wsp. P, I, D
+typedef struct
+{
+  unsigned char zone;       // strojona strefa (0xff - brak)
+  unsigned char state;
+  unsigned char rule;       // regua doboru nastaw
+  unsigned char high;       // wypenienie PWM przy zaczonym przekaniku
+  unsigned char hyst;       // histereza (0,1 st. C)
+  unsigned char relay;      // stan przekanika
+  unsigned char cycles;     // pene okresy oscylacji
+  int pv_max;               // ekstrema PV w biecym okresie
+  int pv_min;
+  unsigned long last_on;    // chwila ostatniego zaczenia (us, 0 - brak)
+  unsigned long start;      // uptime startu
+  unsigned long sum_tu;     // suma okresw (ms)
+  unsigned long sum_a;      // suma amplitud (0,1 st. C)
+  unsigned int ku;          // wynik: wzmocnienie krytyczne (x PID_SCALING_FACTOR)
+  unsigned long tu;         // wynik: okres oscylacji (ms)
+} pid_tuner;
+
 #include "../telemetry.h"
 
+pid_zone pid_zones[PID_COUNT];
+pid_tuner pid_tune;
+
+// stan strojenia
+#define PID_TUNE_IDLE       0
+#define PID_TUNE_RUNNING    1
+#define PID_TUNE_DONE       2
+#define PID_TUNE_FAILED     3
+
+// reguy doboru nastaw
+#define PID_TUNE_ZN         'z'     // Ziegler - Nichols: Kp = 0,6 Ku, Ti = Tu / 2, Td = Tu / 8
+#define PID_TUNE_TL         't'     // Tyreus - Luyben: Kp = Ku / 2,2, Ti = 2,2 Tu, Td = Tu / 6,3
+
+// okresy oscylacji uredniane po pominiciu pierwszego (stan przejciowy) / limit czasu strojenia (s)
+#define PID_TUNE_CYCLES     3
+#define PID_TUNE_TIMEOUT    7200
+
+#define pid_zone_enabled(z)     ( (my_config.pid_sensor[(z)] < DS_DEVICES_MAX) && (my_config.pid_pwm[(z)] < PWM_CHANNELS) )
+
 // inicjalizacja regulatora PID z podanymi wsp. P, I, D
 void pid_init(pid_regulator*, unsigned int, unsigned int, unsigned int);
 
-// cykl pracy regulatora -> aktualizuj wartosci P, I, D wg podanych wartosci SP i PV -> zwroc wysterowanie
+// cykl pracy regulatora -> aktualizuj wartosci P, I, D wg podanych wartosci SP i PV -> zwroc wysterowanie (PID_OUTPUT_MIN..MAX)
 int pid_loop(pid_regulator*, int, int);
 
 // reset integrator w strukturze regulatora PID
@@ -35,4 +97,26 @@ void pid_reset(pid_regulator*);
 // zrzut stanu regulatora do konsoli
 void pid_dump(pid_regulator*);
 
+// inicjalizacja regulatorw stref wg ustawie
+void pid_zones_init();
+
+// ustaw stref <nr> wg definicji "<kana ds>,<kana pwm>,<warto zadana>[,<P>,<I>,<D>]" (pusta - wycz)
+unsigned char pid_zone_set(unsigned char, char*);
+
+// przebiegi regulatorw stref, ktrych czujniki odczytano (maska kanaw) - w przerwaniu, po cyklu pomiarw
+void pid_on_measure(unsigned char);
+
+// rozpocznij strojenie strefy wg definicji "<z|t>,<wypenienie>,<histereza>" (pusta - przerwij strojenie)
+unsigned char pid_tune_start(unsigned char, char*);
+
+// zakocz strojenie (stan kocowy) - bez strojenia nic nie robi; w ptli gwnej wywoywa przy wyczonych przerwaniach
+void pid_tune_stop(unsigned char);
+
+// kolejny pomiar strojonej strefy / wyznaczenie nastaw z zebranych okresw
+void pid_tune_step();
+void pid_tune_finish();
+
+// min(a * b / c, 65534) bez przepenienia iloczynu
+unsigned int pid_tune_scale(unsigned long, unsigned long, unsigned long);
+
 #endif
@@ -1,49 +1,217 @@
 #include "pwm.h"
 
+const unsigned char pwm_map[PWM_CHANNELS] PROGMEM = PWM_MAP;
+
 void pwm_init()
 {
+    unsigned char channel;
+
+    pwm_soft_mask   = 0;
+    pwm_oc2_channel = PWM_CHANNEL_NONE;
+
+    for (channel=0; channel<PWM_CHANNELS; channel++) {
+        switch (pgm_read_byte(&pwm_map[channel])) {
+            case PWM_OC2:
+                pwm_oc2_channel = channel;
+                break;
+
+            default:
+                pwm_soft_mask |= (1 << channel) & PWM_MASK;
+                break;
+        }
+    }
+
     // port sterownika PWM jako wyjscie w stanie niskim
-    DDR(PWM_PORT) |= PWM_MASK;
-    PWM_PORT &= ~PWM_MASK;
+    DDR(PWM_PORT) |= pwm_soft_mask;
+    PWM_PORT &= ~pwm_soft_mask;
+
+    // fast PWM Timer2 (wyjcie OC2 odczone do czasu ustawienia wypenienia)
+    if ( pwm_timer2_used() ) {
+        DDRD  |= (1 << 7);
+        PORTD &= ~(1 << 7);
+
+        OCR2  = 0;
+        TCCR2 = (1 << WGM21) | (1 << WGM20) | PWM_OC2_CS;
+    }
 
     // zeruj pamiec
     memset((void*)pwm_fill, 0x00, 8);
     memset((void*)pwm_fill_buf, 0x00, 8);
 
-    pwm_step = 0;
+    // pierwsze przerwanie rozpocznie okres
+    pwm_edges = 0;
+    pwm_edge  = 0;
+    pwm_wait  = 0;
+
+#ifdef PWM_BCM
+    memset((void*)pwm_planes, 0x00, sizeof(pwm_planes));
+
+    pwm_plane        = 0;
+    pwm_planes_dirty = 0;
+    pwm_bit          = 0;
+#endif
 }
 
+#ifdef PWM_BCM
 void pwm_loop()
 {
-    // pierwszy krok w okresie PWM
-    // przenies dane z bufora wysterowan
-    if (pwm_step == 0) {
-        memcpy((void*)pwm_fill, (void*)pwm_fill_buf, 8);
-    }
-    else if (pwm_step == 1){
-        // ustaw wyjscia PWM, jesli wysterowania > 0
-        for (unsigned char channel=0; channel<8; channel++) {
-            if (pwm_fill[channel] > 0) {
-                PWM_PORT |= (1 << channel);
-            }
-            else {
-                PWM_PORT &= ~(1 << channel);
-            }
-        }
+    // dugi odcinek odmierzany w kilku przerwaniach
+    if (pwm_wait) {
+        pwm_schedule(pwm_wait);
+        return;
+    }
+
+    if (pwm_bit == 0) {
+        pwm_period_start();
+    }
+
+    PWM_PORT = (PWM_PORT & ~pwm_soft_mask) | pwm_planes[pwm_plane][pwm_bit];
+
+    pwm_schedule( (unsigned int)(1 << pwm_bit) * PWM_TICKS );
+
+    pwm_bit = (pwm_bit + 1) & 7;
+}
+
+void pwm_period_start()
+{
+    memcpy((void*)pwm_fill, (void*)pwm_fill_buf, 8);
+
+    // nowe wypenienia od penego okresu - bufor zapisu startuje od biecych bitw
+    if (pwm_planes_dirty) {
+        pwm_plane ^= 1;
+        memcpy((void*)pwm_planes[pwm_plane ^ 1], (void*)pwm_planes[pwm_plane], 8);
+
+        pwm_planes_dirty = 0;
+    }
+}
+#else
+void pwm_loop()
+{
+    unsigned int prev, next;
+
+    // dugi odstp midzy zboczami odmierzany w kilku przerwaniach
+    if (pwm_wait) {
+        pwm_schedule(pwm_wait);
+        return;
+    }
+
+    if (pwm_edge == pwm_edges) {
+        pwm_period_start();
+        prev = 0;
     }
     else {
-        // sprawdz czy nie nalezy wylaczyc jednego z wyjsc
-        for (unsigned char channel=0; channel<8; channel++) {
-            if (pwm_fill[channel] == pwm_step) {
-                PWM_PORT &= ~(1 << channel);
-            }
+        // wylacz kanaly, ktorych wypelnienie sie skonczylo
+        PWM_PORT &= ~pwm_edge_mask[pwm_edge];
+
+        prev = pwm_edge_time[pwm_edge++];
+    }
+
+    // kolejne zbocze lub koniec okresu (256 jednostek)
+    next = (pwm_edge < pwm_edges) ? pwm_edge_time[pwm_edge] : 256;
+
+    pwm_schedule( (next - prev) * PWM_TICKS );
+}
+
+void pwm_period_start()
+{
+    unsigned char channel, fill, pos, n, on = 0;
+
+    memcpy((void*)pwm_fill, (void*)pwm_fill_buf, 8);
+
+    pwm_edges = 0;
+    pwm_edge  = 0;
+
+    // sortowanie przez wstawianie (raz na okres) - kanay o rwnych wypenieniach dziel zbocze
+    for (channel=0; channel<8; channel++) {
+        fill = pwm_fill[channel];
+
+        if ( (fill == 0) || !(pwm_soft_mask & (1 << channel)) ) {
+            continue;
         }
+
+        on |= 1 << channel;
+
+        for (pos = 0; (pos < pwm_edges) && (pwm_edge_time[pos] < fill); pos++);
+
+        if ( (pos < pwm_edges) && (pwm_edge_time[pos] == fill) ) {
+            pwm_edge_mask[pos] |= 1 << channel;
+            continue;
+        }
+
+        for (n = pwm_edges; n > pos; n--) {
+            pwm_edge_time[n] = pwm_edge_time[n-1];
+            pwm_edge_mask[n] = pwm_edge_mask[n-1];
+        }
+
+        pwm_edge_time[pos] = fill;
+        pwm_edge_mask[pos] = 1 << channel;
+        pwm_edges++;
     }
 
-    // kolejny krok
-    pwm_step++;
+    // ustaw wyjscia PWM, jesli wysterowania > 0
+    PWM_PORT = (PWM_PORT & ~pwm_soft_mask) | on;
+}
+#endif
+
+void pwm_schedule(unsigned int ticks)
+{
+    // tryb CTC: przerwanie po OCR0 + 1 taktach (licznik ju wyzerowany) - dusze odstpy
+    // odmierzane w czciach, z ktrych ostatnia ma co najmniej 128 taktw (dusza od obsugi przerwania)
+    if (ticks > 384) {
+        OCR0     = 0xff;
+        pwm_wait = ticks - 256;
+    }
+    else if (ticks > 256) {
+        OCR0     = 0x7f;
+        pwm_wait = ticks - 128;
+    }
+    else {
+        OCR0     = ticks - 1;
+        pwm_wait = 0;
+    }
 }
 
 void pwm_set_fill(unsigned char channel, unsigned char fill) {
+#ifdef PWM_BCM
+    unsigned char b, sreg;
+#endif
+
     pwm_fill_buf[channel] = fill;
+
+    if (channel != pwm_oc2_channel) {
+#ifdef PWM_BCM
+        if ( !(pwm_soft_mask & (1 << channel)) ) {
+            return;
+        }
+
+        // bufor bitw nie moe zosta zamieniony w trakcie zapisu
+        sreg = SREG;
+        cli();
+
+        for (b = 0; b < 8; b++) {
+            if (fill & (1 << b)) {
+                pwm_planes[pwm_plane ^ 1][b] |= (1 << channel);
+            }
+            else {
+                pwm_planes[pwm_plane ^ 1][b] &= ~(1 << channel);
+            }
+        }
+
+        pwm_planes_dirty = 1;
+
+        SREG = sreg;
+#endif
+        return;
+    }
+
+    pwm_fill[channel] = fill;
+
+    // wypenienie (OCR2 + 1) / 256 jak w kanaach programowych - zero: wyjcie odczone w stanie niskim
+    if (fill) {
+        OCR2   = fill - 1;
+        TCCR2 |= (1 << COM21);
+    }
+    else {
+        TCCR2 &= ~(1 << COM21);
+    }
 }
@@ -6,23 +6,56 @@
 // liczba kanaw PWM
 #define PWM_CHANNELS    8
 
+// kana brak
+#define PWM_CHANNEL_NONE    0xff
+
+// wyjcia kanaw (PWM_MAP z telemetry.h)
+extern const unsigned char pwm_map[PWM_CHANNELS] PROGMEM;
+
+// kanay programowe na PWM_PORT / kana na wyjciu OC2
+unsigned char pwm_soft_mask;
+unsigned char pwm_oc2_channel;
+
 // wartosci wysterowan wyjsc PWM
 volatile unsigned char pwm_fill[8];
 volatile unsigned char pwm_fill_buf[8];
 
-// krok cyklu PWM
-volatile unsigned char pwm_step;
+#ifdef PWM_BCM
+// modulacja kodu binarnego: okres 255 jednostek podzielony na 8 odcinkw (1, 2, 4 ... 128 jednostek),
+// w odcinku <b> na PWM_PORT bajt z kanaami, ktrych wypenienie ma ustawiony bit <b>
+volatile unsigned char pwm_planes[2][8];    // bajty portu kolejnych bitw (biecy okres / bufor pwm_set_fill)
+volatile unsigned char pwm_plane;           // bufor biecego okresu
+volatile unsigned char pwm_planes_dirty;    // bufor zmieniony - zamie na pocztku okresu
+volatile unsigned char pwm_bit;             // kolejny odcinek
+#endif
+
+// harmonogram okresu PWM: zbocza opadajce w kolejnoci czasu (rne wypenienia rosnco)
+// przerwanie Timer0 wywoywane tylko w chwilach zboczy (OCR0 - odstp do kolejnego)
+volatile unsigned char pwm_edge_time[PWM_CHANNELS];  // wypenienie (jednostki od pocztku okresu)
+volatile unsigned char pwm_edge_mask[PWM_CHANNELS];  // kanay wyczane w tej chwili
+volatile unsigned char pwm_edges;                    // liczba zboczy w okresie
+volatile unsigned char pwm_edge;                     // kolejne zbocze (pwm_edges - koniec okresu)
+volatile unsigned int  pwm_wait;                     // takty do odczekania przed kolejnym zboczem (odstp > 256 taktw)
 
 // inicjalizacja sterownika PWM
 void pwm_init();
 
-// ustawienie wypelnienia wybranego kanalu PWM
+// ustawienie wypelnienia wybranego kanalu PWM (programowego - od kolejnego okresu, sprztowego - od razu)
 void pwm_set_fill(unsigned char, unsigned char);
 
+// Timer2 zajty przez kana sprztowy
+#define pwm_timer2_used()   ( pwm_oc2_channel != PWM_CHANNEL_NONE )
+
 // pobranie wypelnienia wybranego kanalu PWM
 #define pwm_get_fill(ch) pwm_fill[(ch)]
 
-// pojedynczy przebieg sterownika PWM - aktualizacja wyjsc
+// pojedynczy przebieg sterownika PWM - aktualizacja wyjsc (w przerwaniu Timer0)
 void pwm_loop();
 
+// pocztek okresu: przenies dane z bufora wysterowan i u harmonogram zboczy (BCM: zamie bufory bitw)
+void pwm_period_start();
+
+// kolejne przerwanie za podan liczb taktw Timer0
+void pwm_schedule(unsigned int);
+
 #endif
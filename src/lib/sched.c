@@ -0,0 +1,129 @@
+#include "sched.h"
+
+void sched_init(const sched_task* tasks, unsigned char count) {
+
+    unsigned char n;
+
+    sched_tasks = tasks;
+    sched_count = (count > SCHED_TASKS_MAX) ? SCHED_TASKS_MAX : count;
+
+    memset((void*) sched_states, 0, sizeof(sched_states));
+
+    for (n = 0; n < sched_count; n++) {
+        sched_states[n].next = pgm_read_word(&tasks[n].phase);
+    }
+}
+
+void sched_run() {
+
+    unsigned char n, task = 0xff, priority = 0xff, sreg;
+    unsigned long now, ready = 0, due = 0, deadline;
+#ifdef PERF
+    unsigned long start, exec, ready_us;
+#endif
+    sched_state* state;
+
+    // zadania gotowe (licznik taktw i sched_trigger() zmieniane w przerwaniach)
+    sreg = SREG;
+    cli();
+
+    now = pooling_ticks;
+
+    for (n = 0; n < sched_count; n++) {
+        if (sched_states[n].next > now) {
+            continue;
+        }
+
+        deadline = sched_states[n].next + pgm_read_word(&sched_tasks[n].deadline);
+
+        if ( (pgm_read_byte(&sched_tasks[n].priority) < priority) || ((pgm_read_byte(&sched_tasks[n].priority) == priority) && (deadline < due)) ) {
+            task     = n;
+            priority = pgm_read_byte(&sched_tasks[n].priority);
+            ready    = sched_states[n].next;
+            due      = deadline;
+        }
+    }
+
+    if (task == 0xff) {
+        SREG = sreg;
+        return;
+    }
+
+    state = &sched_states[task];
+
+#ifdef PERF
+    // gotowo od zgoszenia (przerwanie) lub od pocztku taktu
+    ready_us = ready * 25000UL;
+
+    if (state->trigger_us) {
+        ready_us = state->trigger_us;
+        state->trigger_us = 0;
+    }
+
+    SREG = sreg;
+
+    start = sched_time_us();
+
+    ((void (*)()) pgm_read_word(&sched_tasks[task].run))();
+
+    exec = sched_time_us() - start;
+
+    if (exec > state->exec_max) {
+        state->exec_max = exec;
+    }
+
+    if (exec > 0xffff) {
+        exec = 0xffff;
+    }
+
+    // opnienie startu wzgldem gotowoci
+    perf_add(PERF_TASK(task), ( (start - ready_us) > 0xffff ) ? 0xffff : (start - ready_us), exec);
+
+    state->runs++;
+
+    // pierwszy przebieg wyznacza redni
+    state->exec = (state->runs == 1) ? exec : state->exec - (state->exec >> 3) + (exec >> 3);
+#else
+    SREG = sreg;
+
+    ((void (*)()) pgm_read_word(&sched_tasks[task].run))();
+#endif
+
+    cli();
+
+    now = pooling_ticks;
+
+    // kolejny okres - pominite okresy (zadanie zakoczone po kolejnej gotowoci) nie s nadrabiane
+    // (gotowo ustawiona w trakcie przebiegu przez sched_trigger() zostaje)
+    if (state->next == ready) {
+        state->next = ready + pgm_read_word(&sched_tasks[task].period);
+
+        if (state->next <= now) {
+            state->next += ( (now - state->next) / pgm_read_word(&sched_tasks[task].period) + 1 ) * pgm_read_word(&sched_tasks[task].period);
+        }
+    }
+
+    SREG = sreg;
+
+    // zakoczone po terminie (zgaszane przy 1., 2., 4., 8. ... przekroczeniu)
+    if (now > due) {
+        state->overruns++;
+
+        if ( !(state->overruns & (state->overruns - 1)) ) {
+            rs_text_P(PSTR("SCHED: ")); rs_text_P(sched_task_name(task)); rs_text_P(PSTR(" po terminie o "));
+            rs_long(now - due); rs_text_P(PSTR(" x 25 ms (")); rs_long(state->overruns); rs_send(')'); rs_newline();
+        }
+    }
+}
+
+unsigned long sched_time_us() {
+
+    unsigned char sreg = SREG;
+    unsigned long time;
+
+    cli();
+    time = pooling_time_us();
+    SREG = sreg;
+
+    return time;
+}
@@ -0,0 +1,61 @@
+#ifndef _SCHED_H
+#define _SCHED_H
+
+#include "../telemetry.h"
+
+// zadanie okresowe wykonywane w ptli gwnej (tablica w pamici programu, czasy w taktach poolingu - 25 ms)
+typedef struct
+{
+  PGM_P name;
+  void (*run)();
+  unsigned int period;
+  unsigned int phase;       // takt pierwszej gotowoci
+  unsigned int deadline;    // termin zakoczenia liczony od chwili gotowoci (takty)
+  unsigned char priority;   // 0 - najwyszy, przy rwnych - najwczeniejszy termin
+} sched_task;
+
+// stan zadania i statystyki (czasy w us - tylko z PERF)
+typedef struct
+{
+  unsigned long next;       // takt kolejnej gotowoci
+  unsigned int overruns;    // zakoczenia po terminie
+#ifdef PERF
+  unsigned int runs;
+  unsigned int exec;        // redni czas wykonania (rednia kroczca 1/8, nasycany na 65535)
+  unsigned long exec_max;
+  unsigned long trigger_us; // chwila wywoania sched_trigger() (0 - brak) - opnienie startu liczone od niej, a nie od taktu
+#endif
+} sched_state;
+
+// tablica zada
+const sched_task* sched_tasks;
+unsigned char sched_count;
+
+sched_state sched_states[SCHED_TASKS_MAX];
+
+// ustaw tablic zada (przed wczeniem przerwa)
+void sched_init(const sched_task*, unsigned char);
+
+// wykonaj jedno gotowe zadanie (wywoywane w ptli gwnej)
+void sched_run();
+
+// zadanie <n> gotowe od razu (np. po zgoszeniu przerwania) - wywoywane take z ptli gwnej
+static inline void sched_trigger(unsigned char n) {
+
+    unsigned char sreg = SREG;
+
+    cli();
+    sched_states[n].next = pooling_ticks;
+#ifdef PERF
+    sched_states[n].trigger_us = pooling_time_us();
+#endif
+    SREG = sreg;
+}
+
+// nazwa zadania <n>
+#define sched_task_name(n)  ( (PGM_P) pgm_read_word(&sched_tasks[n].name) )
+
+// czas od startu w us - odczyt poza przerwaniami
+unsigned long sched_time_us();
+
+#endif
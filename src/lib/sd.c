@@ -365,6 +365,86 @@ unsigned char sd_write_block(unsigned long sector, unsigned char* buffer)
 
 	return 1;
 }
+unsigned char sd_read_part(unsigned long sector, unsigned int offset, unsigned char* buffer, unsigned int len)
+{
+	unsigned char ret, data;
+	unsigned int i, retry = 0;
+
+	// CS karty w stan niski
+	spi_select(SD_SS_PORT, SD_SS_PIN);
+
+	// wyslij komende odczytu bloku
+    ret = sd_cmd(SD_READ_SINGLE_BLOCK, sector<<9);
+	
+	// sprawdz odpowiedz
+	if(ret != 0x00) {
+        spi_unselect(SD_SS_PORT, SD_SS_PIN);
+		return 0;
+    }
+
+	// czekaj na token poczatku danych
+    while(spi_read() != SD_STARTBLOCK_READ) {
+        if (retry++ > SD_READ_TIMEOUT) {
+            spi_unselect(SD_SS_PORT, SD_SS_PIN);
+            return 0;
+        }
+    }
+
+	// pobierz cay blok, zapamitaj tylko dany fragment
+	for(i=0; i<SD_BLOCK_SIZE; i++) {
+		data = spi_read();
+
+        if ( (i >= offset) && (i < offset+len) ) {
+            *buffer++ = data;
+        }
+	}
+    
+    // CRC
+    spi_read();
+    spi_read();
+
+	// CS karty w stan wysoki
+	spi_unselect(SD_SS_PORT, SD_SS_PIN);
+	
+	return 1;
+}
+
+unsigned char sd_erase(unsigned long first, unsigned long last)
+{
+	unsigned char ret;
+	unsigned long retry = 0;
+
+	// CS karty w stan niski
+	spi_select(SD_SS_PORT, SD_SS_PIN);
+
+	// oznacz zakres blokw do skasowania (karty MMC - grupy kasowania)
+	ret  = sd_cmd( (sd_state == SD_IS_MMC) ? SD_TAG_ERASE_GROUP_START : SD_TAG_SECTOR_START, first<<9);
+	ret |= sd_cmd( (sd_state == SD_IS_MMC) ? SD_TAG_ERARE_GROUP_END   : SD_TAG_SECTOR_END,   last<<9);
+
+	// kasuj
+	if (ret == 0x00) {
+		ret = sd_cmd(SD_ERASE, 0UL);
+	}
+
+	if (ret != 0x00) {
+        spi_unselect(SD_SS_PORT, SD_SS_PIN);
+		return 0;
+	}
+
+	// poczekaj na zakoczenie kasowania (w czasie operacji na linii MISO stan niski)
+	while(!spi_read()) {
+        if (retry++ > SD_ERASE_TIMEOUT) {
+            spi_unselect(SD_SS_PORT, SD_SS_PIN);
+            return 0;
+        }
+    }
+
+    // CS karty w stan wysoki
+	spi_unselect(SD_SS_PORT, SD_SS_PIN);
+
+	return 1;
+}
+
 /**
 
 unsigned char sd_read_stream(unsigned long addr, unsigned char* buffer, unsigned int len) {
@@ -99,6 +99,10 @@
 // rozmiar bloku przesylanych danych
 #define SD_BLOCK_SIZE               512
 
+// limity oczekiwania (liczba odczytanych bajtw, ok. 2 us na bajt przy SPI F_OSC / 2)
+#define SD_READ_TIMEOUT             50000UL     // token pocztku danych (ok. 100 ms)
+#define SD_ERASE_TIMEOUT            1000000UL   // zakoczenie kasowania (ok. 2 s)
+
 // bufor na blok danych z/do karty
 //unsigned char sd_buffer[SD_BLOCK_SIZE];
 
@@ -148,6 +152,12 @@ unsigned char sd_cmd(unsigned char, unsigned long);
 unsigned char sd_read_block(unsigned long, unsigned char*);
 unsigned char sd_write_block(unsigned long, unsigned char*);
 
+// odczyt fragmentu bloku (sektor, offset, bufor, dugo) - bez bufora na cay blok
+unsigned char sd_read_part(unsigned long, unsigned int, unsigned char*, unsigned int);
+
+// kasowanie podanego zakresu blokw (pierwszy, ostatni)
+unsigned char sd_erase(unsigned long, unsigned long);
+
 // odczyt/zapis strumieniowy
 //unsigned char sd_read_stream(unsigned long, unsigned char*, unsigned int);
 //unsigned char sd_write_stream(unsigned long, unsigned char*, unsigned int);
@@ -0,0 +1,285 @@
+#include "stream.h"
+
+unsigned int stream_handle_packet(unsigned char* mac, unsigned char* ip, unsigned int port, unsigned char* data)
+{
+    unsigned char n;
+    stream_subscriber* sub;
+    char* pos;
+
+    switch(data[1]) {
+
+        case STREAM_CMD_SUBSCRIBE:
+            return stream_subscribe(mac, ip, port, data);
+
+        case STREAM_CMD_UNSUBSCRIBE:
+            sub = stream_find(ip, data[2] ? atoi((char*)data+2) : port);
+
+            if (sub) {
+                sub->mask = 0;
+                return 0;
+            }
+            break;
+
+        // paczka zgubiona - odpowied wraca na port nadawcy
+        case STREAM_CMD_NACK:
+            n   = atoi((char*)data+2);
+            pos = strchr((char*)data+2, ',');
+
+            if ( pos && (n < STREAM_SUBSCRIBERS_MAX) && stream_subscribers[n].mask && !memcmp(stream_subscribers[n].ip, ip, 4) ) {
+                return stream_batch(n, (unsigned int)atol(pos+1), STREAM_FLAG_REFILL, data);
+            }
+            break;
+    }
+
+    data[0] = 'e';
+    data[1] = 'r';
+    data[2] = 'r';
+
+    return 3;
+}
+
+unsigned int stream_subscribe(unsigned char* mac, unsigned char* ip, unsigned int port, unsigned char* data)
+{
+    // maska, interwa, prbek w paczce, dzierawa, port
+    unsigned int param[5] = {0, 0, 0, 0, port};
+    unsigned char n;
+    char* pos = (char*)data+2;
+    stream_subscriber* sub;
+
+    for (n = 0; (n < 5) && pos; n++) {
+        param[n] = atoi(pos);
+        pos = strchr(pos, ',');
+
+        if (pos) {
+            pos++;
+        }
+    }
+
+    // wszystkie prbki paczki musz mieci si w historii
+    if ( (n < 4) || !param[0] || (param[0] > 0xff) || !param[1] || !param[2] || (param[2] > STREAM_BATCH_MAX) || ((param[2] - 1) * param[1] >= STREAM_HISTORY) || !param[3] || (param[3] > STREAM_LEASE_MAX) ) {
+        data[0] = 'e';
+        data[1] = 'r';
+        data[2] = 'r';
+
+        return 3;
+    }
+
+    sub = stream_find(ip, param[4]);
+
+    // nowa subskrypcja - wolne miejsce w tablicy
+    if (!sub) {
+        for (n = 0; n < STREAM_SUBSCRIBERS_MAX; n++) {
+            if (!stream_subscribers[n].mask) {
+                sub = &stream_subscribers[n];
+                break;
+            }
+        }
+
+        if (!sub) {
+            data[0] = 'e';
+            data[1] = 'r';
+            data[2] = 'r';
+
+            return 3;
+        }
+
+        sub->mask = 0;
+    }
+
+    // odnowienie z tymi samymi parametrami zachowuje numeracj paczek
+    if ( (sub->mask != param[0]) || (sub->interval != param[1]) || (sub->batch != param[2]) ) {
+        sub->mask     = param[0];
+        sub->interval = param[1];
+        sub->batch    = param[2];
+        sub->seq      = 0;
+        sub->start    = stream_tick + 1;
+    }
+
+    sub->lease = param[3];
+    sub->port  = param[4];
+
+    memcpy(sub->ip,  ip,  sizeof(sub->ip));
+    memcpy(sub->mac, mac, sizeof(sub->mac));
+
+    n = sub - stream_subscribers;
+
+    rs_text_P(PSTR("STREAM: subskrypcja #")); rs_int(n); rs_send(' '); net_dump_ip(sub->ip); rs_send(':'); rs_int(sub->port); rs_newline();
+
+    // numer subskrypcji, numer kolejnej paczki, dzierawa
+    data[0] = n;
+    data[1] = sub->seq & 0xff;
+    data[2] = sub->seq >> 8;
+    data[3] = sub->lease & 0xff;
+    data[4] = sub->lease >> 8;
+
+    return 5;
+}
+
+stream_subscriber* stream_find(unsigned char* ip, unsigned int port)
+{
+    unsigned char n;
+
+    for (n = 0; n < STREAM_SUBSCRIBERS_MAX; n++) {
+        if ( stream_subscribers[n].mask && (stream_subscribers[n].port == port) && !memcmp(stream_subscribers[n].ip, ip, sizeof(stream_subscribers[n].ip)) ) {
+            return &stream_subscribers[n];
+        }
+    }
+
+    return 0;
+}
+
+unsigned int stream_batch(unsigned char n, unsigned int seq, unsigned char flags, unsigned char* data)
+{
+    stream_subscriber* sub = &stream_subscribers[n];
+    stream_header* header = (stream_header*) data;
+    unsigned int first, age, len = sizeof(stream_header);
+    unsigned char i;
+
+    // paczki nastpuj po sobie bez przerw - takt pierwszej prbki wczeniejszej paczki wynika z jej numeru
+    first = sub->start - (sub->seq - seq) * sub->batch * sub->interval;
+    age   = stream_tick - first;
+
+    header->id       = n;
+    header->mask     = sub->mask;
+    header->seq      = seq;
+    header->interval = sub->interval;
+    header->count    = 0;
+    header->flags    = flags;
+    header->time     = 0;
+
+    // najstarsza prbka wypada ju z historii / najnowszej jeszcze nie ma
+    if ( (age >= stream_history_count) || (age < (sub->batch - 1) * sub->interval) ) {
+        header->flags |= STREAM_FLAG_LOST;
+        return len;
+    }
+
+    header->time  = stream_tick_time - age;
+    header->count = sub->batch;
+
+    for (i = 0; i < sub->batch; i++, first += sub->interval) {
+        len += stream_row(data + len, sub->mask, stream_history[first % STREAM_HISTORY]);
+    }
+
+    return len;
+}
+
+unsigned int stream_row(unsigned char* data, unsigned char mask, signed int* row)
+{
+    unsigned char ch;
+    unsigned int len = 0;
+
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+        if (mask & (1 << ch)) {
+            // little endian - intel / avr
+            memcpy((void*)(data + len), (void*)&row[ch], sizeof(signed int));
+            len += sizeof(signed int);
+        }
+    }
+
+    return len;
+}
+
+void stream_send(unsigned char n, unsigned int seq, unsigned char flags)
+{
+    unsigned int len;
+    stream_subscriber* sub = &stream_subscribers[n];
+
+    // pakiet budowany w buforze odbiorczym (odebrane pakiety obsuono wczeniej w tym takcie)
+    ethernet_packet *eth  = (ethernet_packet*) net_packet;
+    ip_packet       *ip   = (ip_packet*) (eth->data);
+    udp_packet      *udp  = (udp_packet*) (ip->data);
+
+    len = stream_batch(n, seq, flags, udp->data);
+
+    len = net_make_udp_packet(udp, DAQ_PORT, sub->port, udp->data, len);
+    len = net_make_ip_packet(ip, NET_IP_UDP, (uint8_t*) udp, sub->ip, len);
+    len = net_make_eth_packet(eth, (uint8_t*) ip, sub->mac, len);
+
+    eth->eth_type = HTONS(NET_IP4_FRAME);
+
+    enc28_packet_send((uint8_t*)eth, len);
+}
+
+void stream_mcast_send()
+{
+    unsigned int len;
+    mac_addr mac;
+
+    ethernet_packet *eth    = (ethernet_packet*) net_packet;
+    ip_packet       *ip     = (ip_packet*) (eth->data);
+    udp_packet      *udp    = (udp_packet*) (ip->data);
+    stream_header   *header = (stream_header*) udp->data;
+
+    header->id       = STREAM_MCAST_ID;
+    header->mask     = (1 << ds_devices_count) - 1;
+    header->seq      = stream_mcast_seq++;
+    header->time     = stream_tick_time;
+    header->interval = my_config.mcast_interval;
+    header->count    = 1;
+    header->flags    = 0;
+
+    len = sizeof(stream_header) + stream_row(udp->data + sizeof(stream_header), header->mask, stream_history[stream_tick % STREAM_HISTORY]);
+
+    // ramka na adres MAC grupy - jedna transmisja dla wszystkich odbiorcw
+    net_multicast_mac(net_igmp_group, mac);
+
+    len = net_make_udp_packet(udp, DAQ_PORT, DAQ_PORT, udp->data, len);
+    len = net_make_ip_packet(ip, NET_IP_UDP, (uint8_t*) udp, net_igmp_group, len);
+    len = net_make_eth_packet(eth, (uint8_t*) ip, mac, len);
+
+    eth->eth_type = HTONS(NET_IP4_FRAME);
+
+    enc28_packet_send((uint8_t*)eth, len);
+}
+
+void stream_pooling()
+{
+    unsigned char n, sent;
+    stream_subscriber* sub;
+
+    // migawka pomiarw (numer taktu modulo STREAM_HISTORY wskazuje miejsce w historii)
+    stream_tick++;
+    stream_tick_time = fs_get_time();
+
+    memcpy((void*)stream_history[stream_tick % STREAM_HISTORY], (void*)ds_temp, sizeof(stream_history[0]));
+
+    if (stream_history_count < STREAM_HISTORY) {
+        stream_history_count++;
+    }
+
+    for (n = 0; n < STREAM_SUBSCRIBERS_MAX; n++) {
+        sub = &stream_subscribers[n];
+
+        if (!sub->mask) {
+            continue;
+        }
+
+        sub->lease--;
+        sent = 0;
+
+        // w biecym takcie przypada ostatnia prbka paczki
+        if ( (unsigned int)(stream_tick - sub->start) == (sub->batch - 1) * sub->interval ) {
+            stream_send(n, sub->seq, sub->lease ? 0 : STREAM_FLAG_LAST);
+
+            sub->seq++;
+            sub->start += sub->batch * sub->interval;
+            sent = 1;
+        }
+
+        // koniec dzierawy - pusta paczka koczca, gdy adna nie wysza w tym takcie
+        if (sub->lease == 0) {
+            if (!sent) {
+                stream_send(n, sub->seq, STREAM_FLAG_LAST | STREAM_FLAG_LOST);
+            }
+
+            rs_text_P(PSTR("STREAM: koniec dzierzawy #")); rs_int(n); rs_newline();
+
+            sub->mask = 0;
+        }
+    }
+
+    // publikacja w grupie multicast (po uzyskaniu adresu IP)
+    if ( my_config.mcast_interval && net_is_multicast(net_igmp_group) && my_net_config.my_ip[0] && !(stream_tick % my_config.mcast_interval) ) {
+        stream_mcast_send();
+    }
+}
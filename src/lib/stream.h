@@ -0,0 +1,83 @@
+#ifndef _STREAM_H
+#define _STREAM_H
+
+#include "../telemetry.h"
+
+// polecenia subskrypcji (na porcie DAQ)
+#define STREAM_CMD                  'u'
+#define STREAM_CMD_SUBSCRIBE        's'     // us<maska>,<interwa>,<prbek w paczce>,<dzierawa>[,<port>] - odnowienie tym samym poleceniem
+#define STREAM_CMD_UNSUBSCRIBE      'u'     // uu[<port>] - wyrejestruj nadawc polecenia
+#define STREAM_CMD_NACK             'n'     // un<nr subskrypcji>,<nr paczki> - powtrz zgubion paczk
+
+// numer "subskrypcji" w paczkach publikowanych w grupie multicast (port DAQ_PORT, jedna prbka wszystkich kanaw)
+#define STREAM_MCAST_ID             0xff
+
+// maks. liczba prbek w paczce / czas dzierawy (s)
+#define STREAM_BATCH_MAX            STREAM_HISTORY
+#define STREAM_LEASE_MAX            3600
+
+// znaczniki paczki
+#define STREAM_FLAG_REFILL          0x01    // paczka powtrzona na danie (NACK)
+#define STREAM_FLAG_LOST            0x02    // prbek nie ma ju w historii - paczka bez prbek
+#define STREAM_FLAG_LAST            0x04    // ostatnia paczka (koniec dzierawy)
+
+// nagwek paczki (little endian), za nim <count> wierszy po jednej prbce int16 kadego kanau z maski
+typedef struct {
+    unsigned char id;           // numer subskrypcji
+    unsigned char mask;
+    unsigned int  seq;          // numer paczki
+    unsigned long time;         // czas pierwszej prbki (jak w FS)
+    unsigned int  interval;     // okres prbkowania (s)
+    unsigned char count;        // liczba wierszy
+    unsigned char flags;
+} stream_header; /* 12 */
+
+// subskrybent
+typedef struct {
+    unsigned char mask;         // maska kanaw (0 - wolne miejsce w tablicy)
+    unsigned char batch;        // prbek w paczce
+    unsigned int  interval;
+    unsigned int  lease;        // pozostay czas dzierawy (s)
+    unsigned int  seq;          // numer kolejnej paczki
+    unsigned int  start;        // takt historii pierwszej prbki kolejnej paczki
+    unsigned int  port;
+    unsigned char ip[4];
+    unsigned char mac[6];          // nadawca polecenia (lub brama, gdy subskrybent jest poza sieci lokaln)
+} stream_subscriber;
+
+stream_subscriber stream_subscribers[STREAM_SUBSCRIBERS_MAX];
+
+// historia pomiarw (migawka co takt) - rdo paczek, rwnie powtarzanych
+signed int stream_history[STREAM_HISTORY][DS_DEVICES_MAX];
+unsigned char stream_history_count;
+unsigned int  stream_tick;          // numer ostatniej migawki
+unsigned long stream_tick_time;     // czas ostatniej migawki
+
+// numer kolejnej paczki publikowanej w grupie multicast
+unsigned int stream_mcast_seq;
+
+// obsu polecenie subskrypcji (adres MAC, IP i port nadawcy, dane)
+unsigned int stream_handle_packet(unsigned char*, unsigned char*, unsigned int, unsigned char*);
+
+// zarejestruj / odnw subskrypcj
+unsigned int stream_subscribe(unsigned char*, unsigned char*, unsigned int, unsigned char*);
+
+// subskrypcja danego adresu (lub 0)
+stream_subscriber* stream_find(unsigned char*, unsigned int);
+
+// zbuduj paczk <nr paczki> subskrypcji <nr> (zwraca dugo)
+unsigned int stream_batch(unsigned char, unsigned int, unsigned char, unsigned char*);
+
+// dopisz wiersz prbek kanaw z maski (zwraca dugo)
+unsigned int stream_row(unsigned char*, unsigned char, signed int*);
+
+// wylij paczk do subskrybenta
+void stream_send(unsigned char, unsigned int, unsigned char);
+
+// wylij najnowsz migawk do grupy multicast
+void stream_mcast_send();
+
+// migawka pomiarw i rozesanie penych paczek (co sekund)
+void stream_pooling();
+
+#endif
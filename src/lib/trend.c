@@ -0,0 +1,245 @@
+#include "../telemetry.h"
+
+unsigned char trend_init(unsigned char* buf) {
+
+    unsigned long last_sector = TREND_FIRST_SECTOR + TREND_MINUTE_SECTORS + TREND_HOUR_SECTORS;
+
+    // ustawienie wskazanego bufora na operacje I/O
+    trend_buf = buf;
+
+    trend_minute_start = 0;
+    trend_hour_start   = 0;
+
+    trend_reset(trend_minute);
+
+    // obszar agregatw musi zmieci si na karcie i przed partycj FAT
+    trend_ready = (sd_get_state() != SD_FAILED) && (last_sector <= (sd_size >> 9));
+
+    if ( fat_is_mounted() && (fat.part_first_sector_off < last_sector) ) {
+        trend_ready = 0;
+    }
+
+    return trend_ready;
+}
+
+void trend_update() {
+
+    unsigned long now, minute, hour;
+    unsigned char ch;
+    signed int temp;
+    time_t time;
+
+    if ( !trend_ready ) {
+        return;
+    }
+
+    ds1306_time_get(&time);
+    now = mktime(&time);
+
+    minute = now - (now % 60);
+
+    // rozpocza si kolejna minuta
+    if (minute != trend_minute_start) {
+
+        // zapisz zakoczon minut
+        if (trend_minute_start) {
+            trend_write(TREND_TIER_MINUTE, trend_minute_start, trend_minute);
+        }
+
+        hour = minute - (minute % 3600);
+
+        // rozpocza si kolejna godzina - z zakoczon z zapisanych minut
+        if (hour != trend_hour_start) {
+            if (trend_hour_start) {
+                trend_write_hour(trend_hour_start);
+            }
+
+            trend_hour_start = hour;
+        }
+
+        trend_reset(trend_minute);
+        trend_minute_start = minute;
+    }
+
+    // dolicz biece pomiary
+    for (ch = 0; ch < ds_devices_count; ch++) {
+        temp = ds_temp[ch];
+
+        if (temp < trend_minute[ch].min) trend_minute[ch].min = temp;
+        if (temp > trend_minute[ch].max) trend_minute[ch].max = temp;
+
+        trend_minute[ch].sum += temp;
+        trend_minute[ch].count++;
+    }
+}
+
+unsigned long trend_period(unsigned char tier) {
+    return (tier == TREND_TIER_MINUTE) ? 60UL : 3600UL;
+}
+
+unsigned char trend_select_tier(unsigned long from, unsigned long to, unsigned int points) {
+
+    time_t time;
+
+    ds1306_time_get(&time);
+
+    // agregaty minutowe, o ile nie zostay jeszcze nadpisane w piercieniu, a punkt wykresu jest krtszy
+    // ni godzina (dusze punkty czone s z mniejszej liczby agregatw godzinowych)
+    if ( ((to - from) / points < 3600) && (from + (unsigned long)TREND_MINUTE_SECTORS*TREND_RECORDS_PER_SECTOR*60 > mktime(&time)) ) {
+        return TREND_TIER_MINUTE;
+    }
+
+    return TREND_TIER_HOUR;
+}
+
+unsigned char trend_query(unsigned char tier, unsigned char ch, unsigned long from, unsigned long to, trend_point* point) {
+
+    unsigned long period = trend_period(tier);
+    unsigned long ts;
+    signed long sum = 0;
+    unsigned int count = 0;
+
+    trend_record rec;
+
+    point->min   = 0x7fff;
+    point->max   = -0x7fff;
+    point->count = 0;
+
+    // kolejne okresy z przedziau
+    for (ts = from - (from % period); ts < to; ts += period) {
+
+        if ( !trend_read(tier, ts, &rec) || !(rec.mask & (1 << ch)) ) {
+            continue;
+        }
+
+        if (rec.point[ch].min < point->min) point->min = rec.point[ch].min;
+        if (rec.point[ch].max > point->max) point->max = rec.point[ch].max;
+
+        // rednia waona liczb prbek
+        sum   += (signed long)rec.point[ch].mean * rec.point[ch].count;
+        count += rec.point[ch].count;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    point->mean  = sum / count;
+    point->count = (count > 255) ? 255 : count;
+
+    return 1;
+}
+
+unsigned long trend_slot(unsigned char tier, unsigned long ts) {
+
+    if (tier == TREND_TIER_MINUTE) {
+        return (ts / 60) % ((unsigned long)TREND_MINUTE_SECTORS * TREND_RECORDS_PER_SECTOR);
+    }
+    else {
+        return (ts / 3600) % ((unsigned long)TREND_HOUR_SECTORS * TREND_RECORDS_PER_SECTOR);
+    }
+}
+
+unsigned char trend_write(unsigned char tier, unsigned long ts, trend_acc* acc) {
+
+    unsigned long slot   = trend_slot(tier, ts);
+    unsigned long sector = TREND_FIRST_SECTOR + ((tier == TREND_TIER_MINUTE) ? 0 : TREND_MINUTE_SECTORS) + slot / TREND_RECORDS_PER_SECTOR;
+    unsigned char ch;
+
+    trend_record* rec = (trend_record*) (trend_buf + (slot % TREND_RECORDS_PER_SECTOR) * TREND_RECORD_SIZE);
+
+    if ( !sd_read_block(sector, trend_buf) ) {
+        return 0;
+    }
+
+    memset((void*)rec, 0, TREND_RECORD_SIZE);
+
+    rec->timestamp = ts;
+
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+        if (acc[ch].count == 0) {
+            continue;
+        }
+
+        rec->mask |= (1 << ch);
+
+        rec->point[ch].min   = acc[ch].min;
+        rec->point[ch].max   = acc[ch].max;
+        rec->point[ch].mean  = acc[ch].sum / (signed long)acc[ch].count;
+        rec->point[ch].count = (acc[ch].count > 255) ? 255 : acc[ch].count;
+    }
+
+    rec->crc = trend_crc(rec);
+
+    return sd_write_block(sector, trend_buf);
+}
+
+unsigned char trend_write_hour(unsigned long ts) {
+
+    unsigned long minute;
+    unsigned char ch;
+
+    trend_acc acc[DS_DEVICES_MAX];
+    trend_record rec;
+
+    trend_reset(acc);
+
+    for (minute = ts; minute < ts + 3600; minute += 60) {
+
+        if ( !trend_read(TREND_TIER_MINUTE, minute, &rec) ) {
+            continue;
+        }
+
+        for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+            if ( !(rec.mask & (1 << ch)) ) {
+                continue;
+            }
+
+            if (rec.point[ch].min < acc[ch].min) acc[ch].min = rec.point[ch].min;
+            if (rec.point[ch].max > acc[ch].max) acc[ch].max = rec.point[ch].max;
+
+            // rednia waona liczb prbek
+            acc[ch].sum   += (signed long)rec.point[ch].mean * rec.point[ch].count;
+            acc[ch].count += rec.point[ch].count;
+        }
+    }
+
+    return trend_write(TREND_TIER_HOUR, ts, acc);
+}
+
+unsigned char trend_read(unsigned char tier, unsigned long ts, trend_record* rec) {
+
+    unsigned long slot   = trend_slot(tier, ts);
+    unsigned long sector = TREND_FIRST_SECTOR + ((tier == TREND_TIER_MINUTE) ? 0 : TREND_MINUTE_SECTORS) + slot / TREND_RECORDS_PER_SECTOR;
+
+    if ( !trend_ready || !sd_read_part(sector, (slot % TREND_RECORDS_PER_SECTOR) * TREND_RECORD_SIZE, (unsigned char*)rec, TREND_RECORD_SIZE) ) {
+        return 0;
+    }
+
+    // rekord poprzedniego "okrenia" piercienia lub uszkodzony
+    return (rec->timestamp == ts) && (rec->crc == trend_crc(rec));
+}
+
+unsigned int trend_crc(trend_record* rec) {
+
+    unsigned int crc = 0xffff;
+    unsigned char i;
+
+    for (i = 0; i < TREND_RECORD_SIZE - sizeof(unsigned int); i++) {
+        crc = _crc_ccitt_update(crc, ((unsigned char*)rec)[i]);
+    }
+
+    return crc;
+}
+
+void trend_reset(trend_acc* acc) {
+
+    unsigned char ch;
+
+    for (ch = 0; ch < DS_DEVICES_MAX; ch++) {
+        acc[ch].min   = 0x7fff;
+        acc[ch].max   = -0x7fff;
+        acc[ch].sum   = 0;
+        acc[ch].count = 0;
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef _TREND_H
+#define _TREND_H
+
+#include "../telemetry.h"
+
+//
+// agregaty temperatur (min / max / rednia) - poziom minutowy i godzinowy
+//
+// agregat minutowy aktualizowany jest przy kadym odczycie czujnikw (O(1) na prbk), zamknity okres
+// zapisywany jest na kart SD w piercieniu adresowanym czasem: okres rozpoczynajcy si w chwili <ts>
+// trafia zawsze na pozycj (ts / dugo okresu) % liczba pozycji - odczyt nie wymaga przeszukiwania
+//
+// agregat godzinowy nie zajmuje RAM - po zakoczeniu godziny skadany jest z jej rekordw minutowych z karty
+//
+
+// poziomy agregacji
+#define TREND_TIER_MINUTE           0
+#define TREND_TIER_HOUR             1
+
+// rozmiar rekordu na karcie
+#define TREND_RECORD_SIZE           64
+#define TREND_RECORDS_PER_SECTOR    (512 / TREND_RECORD_SIZE)
+
+// agregat kanau w zapisanym okresie
+typedef struct {
+    signed int    min;
+    signed int    max;
+    signed int    mean;
+    unsigned char count;            // liczba prbek (nasycana na 255)
+} trend_point; // 7
+
+// rekord okresu na karcie
+typedef struct {
+    unsigned long timestamp;        // pocztek okresu (sekundy od 1970 roku)
+    unsigned char mask;             // kanay z prbkami
+    trend_point   point[DS_DEVICES_MAX];
+    unsigned char reserved;
+    unsigned int  crc;              // CRC16 (CCITT) poprzedzajcych pl
+} trend_record; // 4 + 1 + 56 + 1 + 2 = 64
+
+// agregat biecego okresu (RAM)
+typedef struct {
+    signed int    min;
+    signed int    max;
+    signed long   sum;
+    unsigned int  count;
+} trend_acc;
+
+// bufor na operacje I/O
+unsigned char* trend_buf;
+
+// czy obszar agregatw jest dostpny na karcie?
+unsigned char trend_ready;
+
+// biece okresy
+unsigned long trend_minute_start;
+unsigned long trend_hour_start;
+
+trend_acc trend_minute[DS_DEVICES_MAX];
+
+// inicjalizacja - sprawdzenie obszaru karty
+unsigned char trend_init(unsigned char*);
+
+// dodaj biece pomiary ds_temp[] do agregatw (wywoywane po odczycie czujnikw)
+void trend_update();
+
+// dugo okresu poziomu agregacji (s)
+unsigned long trend_period(unsigned char);
+
+// wybierz najdokadniejszy poziom agregacji z danymi dla zakresu czasu (punkty cz kolejne okresy poziomu)
+unsigned char trend_select_tier(unsigned long, unsigned long, unsigned int);
+
+// agregat kanau z przedziau [od, do) - czy kolejne okresy poziomu (zwraca 0, gdy brak danych)
+unsigned char trend_query(unsigned char, unsigned char, unsigned long, unsigned long, trend_point*);
+
+//
+// funkcje wewntrzne
+//
+
+// numer pozycji okresu w piercieniu poziomu
+unsigned long trend_slot(unsigned char, unsigned long);
+
+// zapisz zamknity okres na kart
+unsigned char trend_write(unsigned char, unsigned long, trend_acc*);
+
+// zapisz agregat godziny rozpoczynajcej si w chwili <ts> zoony z jej rekordw minutowych
+unsigned char trend_write_hour(unsigned long);
+
+// odczytaj okres z karty (zwraca 0, gdy rekord jest nieaktualny lub uszkodzony)
+unsigned char trend_read(unsigned char, unsigned long, trend_record*);
+
+// suma kontrolna rekordu
+unsigned int trend_crc(trend_record*);
+
+// wyczy agregaty
+void trend_reset(trend_acc*);
+
+#endif
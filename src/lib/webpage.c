@@ -11,12 +11,12 @@ const char WEBPAGE_DONT_CACHE[] PROGMEM = "\nCache-Control: max-age=0";
 // obsluga zadan HTTP
 unsigned int webpage_handle_http(void* tcp, unsigned char* tcp_data)
 {
-    char query[40];
+    char query[WEBPAGE_QUERY_MAX];
     unsigned int len = 0;
 
     rs_text_P(PSTR("HTTP "));
 
-    for (len=0; (tcp_data[len] != 0x0d) && (len < 40); len++)
+    for (len=0; (tcp_data[len] != 0x0d) && (len < WEBPAGE_QUERY_MAX-1); len++)
         rs_send(query[len]=tcp_data[len]);
 
     query[len] = 0; // zakoncz lancuch NULLem
@@ -132,7 +132,7 @@ unsigned int webpage_get_setup_page(void* tcp) {
    unsigned int len = webpage_print_header(tcp, 0);
 
     // tabelka z informacjami + JS do jej wypenienia
-    len += firmware_read_sector(3, ((tcp_packet*)tcp)->data + len);
+    len = webpage_print_sector(tcp, len, 3);
 
     // stopka (info o systemie)
     len = webpage_print_footer(tcp, len);
@@ -145,7 +145,7 @@ unsigned int webpage_get_pwm_page(void* tcp) {
     unsigned int len = webpage_print_header(tcp, 0);
 
     // tabelka z informacjami o wypenieniach kanaw PWM + opcja ich zmiany
-    len += firmware_read_sector(4, ((tcp_packet*)tcp)->data + len);
+    len = webpage_print_sector(tcp, len, 4);
 
     // stopka (info o systemie)
     len = webpage_print_footer(tcp, len);
@@ -158,7 +158,7 @@ unsigned int webpage_get_info_page(void* tcp) {
     unsigned int len = webpage_print_header(tcp, 0);
 
     // tabelka z informacjami + JS do jej wypenienia
-    len += firmware_read_sector(2, ((tcp_packet*)tcp)->data + len);
+    len = webpage_print_sector(tcp, len, 2);
 
     // stopka (info o systemie)
     len = webpage_print_footer(tcp, len);
@@ -171,7 +171,7 @@ unsigned int webpage_get_ident_page(void* tcp) {
     unsigned int len = webpage_print_header(tcp, 0);
 
     // informacja o procedurze identyfikacji + JS do jej przeprowadzenia
-    len += firmware_read_sector(5, ((tcp_packet*)tcp)->data + len);
+    len = webpage_print_sector(tcp, len, 5);
 
     // stopka (info o systemie)
     len = webpage_print_footer(tcp, len);
@@ -187,11 +187,11 @@ unsigned int webpage_get_daq_page(void* tcp) {
     // sprawd stan karty przed wysaniem odpowiedzi do klienta
     if ( sd_get_state() != SD_FAILED ) {
         // strona z informacj o akwizycji (biecy stan, ustawienia nowego zadania...)
-        len += firmware_read_sector(6, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 6);
     }
     else {
         // brak / bd karty -> stosowny komunikat
-        len += firmware_read_sector(7, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 7);
     }
 
     // stopka (info o systemie)
@@ -207,11 +207,11 @@ unsigned int webpage_get_daq_list(void* tcp) {
     // sprawd stan karty przed wysaniem odpowiedzi do klienta
     if ( sd_get_state() != SD_FAILED ) {
         // strona z list plikw z pomiarami
-        len += firmware_read_sector(8, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 8);
     }
     else {
         // brak / bd karty -> stosowny komunikat
-        len += firmware_read_sector(7, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 7);
     }
 
     // stopka (info o systemie)
@@ -228,17 +228,32 @@ unsigned int webpage_get_daq_data(char* query, void* tcp) {
     char* pos = (char*) strchr(query, ' ');
     *pos = 0;
 
+    // opcjonalnie numer kanau: /daq/get/<nazwa>/<kana>
+    unsigned char ch = 0xFF;
+
+    pos = (char*) strchr(query, '/');
+
+    if (pos) {
+        *pos = 0;
+        ch = atoi(pos+1);
+    }
+
     rs_send('d'); rs_text(query); rs_newline();
 
     // nagwki
     len = net_tcp_write_data_P(tcp, len, PSTR("HTTP/1.0 200 OK\nContent-Type: text/plain"));
     len = net_tcp_write_data_P(tcp, len, WEBPAGE_SERVER);
 
-    // plik
+    // plik z opisem zadania
     fs_file fp;
+    daq_header header;
 
     // temperatura
     signed int temp;
+    unsigned int n = 0;
+
+    // dekoder prbek z dziennika
+    journal_cursor cur;
 
     // bufor do konwersji liczb na acuch znakw
     char buf[4];
@@ -254,8 +269,15 @@ unsigned int webpage_get_daq_data(char* query, void* tcp) {
         ((tcp_packet*)tcp)->data[len++] = '\n';
         */
 
-        // czytaj cay plik
-        while( fs_read(&fp, (unsigned char*)(&temp), 2) && len < 1200 ) {
+        if ( fs_read(&fp, (unsigned char*)&header, sizeof(daq_header)) ) {
+            daq_cursor_init(&cur, &header, ch);
+        }
+        else {
+            header.samples = 0;
+        }
+
+        // czytaj prbki zadania z dziennika pomiarw (dekodowane w locie)
+        while( (n++ < header.samples) && journal_cursor_next(&cur, &temp, 0) ) {
             ltoa(abs(temp)/10, buf, 10);
 
             // znak - ?
@@ -294,7 +316,27 @@ unsigned int webpage_print_header(void* tcp, unsigned int len)
     len = net_tcp_write_data_P(tcp, len, WEBPAGE_SERVER);       // przedstawmy si
 
     // pobierz head.htm z pamieci EEPROM
-    len += firmware_read_sector(1, ((tcp_packet*)tcp)->data + len);
+    len = webpage_print_sector(tcp, len, 1);
+
+    return len;
+}
+
+
+unsigned int webpage_print_sector(void* tcp, unsigned int len, unsigned char sector)
+{
+    unsigned int offset = 0, n;
+
+    // sektor jest duszy ni segment - czytaj do zapenienia segmentu i wysyaj
+    do {
+        if (len >= NET_TCP_DATA_MAX) {
+            len = net_tcp_flush(tcp, len, NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK);
+        }
+
+        n = firmware_read_part(sector, offset, ((tcp_packet*)tcp)->data + len, NET_TCP_DATA_MAX - len);
+
+        offset += n;
+        len    += n;
+    } while (n > 0);
 
     return len;
 }
@@ -343,45 +385,45 @@ unsigned int webpage_get_static_content(char* query, void* tcp)
 
     // favikonka
     if (strncasecmp_P(query, PSTR("favicon.png"), 11) == 0) {
-        len += firmware_read_sector(10, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 10);
     }
     // loading
     else if (strncasecmp_P(query, PSTR("loading.gif"), 11) == 0) {
-        len += firmware_read_sector(11, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 11);
     }
     //
     // CSS
     else if (strncasecmp_P(query, PSTR("telemetry.css"), 13) == 0) {
-        len += firmware_read_sector(20, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 20);
     }
     else if (strncasecmp_P(query, PSTR("css.css"), 7) == 0) {
-        len += firmware_read_sector(21, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 21);
     }
     else if (strncasecmp_P(query, PSTR("daq.css"), 7) == 0) {
-        len += firmware_read_sector(22, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 22);
     }
     //
     // JS
     else if (strncasecmp_P(query, PSTR("util.js"), 7) == 0) {
-        len += firmware_read_sector(30, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 30);
     }
     else if (strncasecmp_P(query, PSTR("js.js"), 5) == 0) {
-        len += firmware_read_sector(31, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 31);
     }
     else if (strncasecmp_P(query, PSTR("pwm.js"), 6) == 0) {
-        len += firmware_read_sector(32, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 32);
     }
     else if (strncasecmp_P(query, PSTR("ident.js"), 6) == 0) {
-        len += firmware_read_sector(33, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 33);
     }
     else if (strncasecmp_P(query, PSTR("info.js"), 6) == 0) {
-        len += firmware_read_sector(34, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 34);
     }
     else if (strncasecmp_P(query, PSTR("daq.js"), 6) == 0) {
-        len += firmware_read_sector(35, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 35);
     }
     else if (strncasecmp_P(query, PSTR("daq_list.js"), 11) == 0) {
-        len += firmware_read_sector(36, ((tcp_packet*)tcp)->data + len);
+        len = webpage_print_sector(tcp, len, 36);
     }
     else {
         return 0;
@@ -582,20 +624,29 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
         len = net_tcp_write_data_P(tcp, len, PSTR(",\"eeprom\":"));
         len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
 
-        // zadanie DAQ -> pozostao prbek do zebrania
-        itoa(daq_task.samples, buf, 10);
+        // zadania DAQ -> pozostao prbek do zebrania
+        itoa(daq_samples_left(), buf, 10);
 
         len = net_tcp_write_data_P(tcp, len, PSTR(",\"daq-samples\":"));
         len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
 
+        // liczba trwajcych / maksymalna liczba zada
+        itoa(daq_tasks_running(), buf, 10);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"daq-tasks\":"));
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"daq-tasks-max\":"));
+        ((tcp_packet*)tcp)->data[len++] = '0' + DAQ_TASKS_MAX;
+
         // zamknij tablic JS
         ((tcp_packet*)tcp)->data[len++] = '}';
     }
     //
     // danie JSON rozpoczcia akwizycji danych
     //
-    // /json/daq/start/pomiar/0/5/200
-    //                /<nazwa_pliku>/<nr_kanau>/<interwa_pomiarw>/<liczba_prbek>
+    // /json/daq/start/pomiar/0,2,5/5/200
+    //                /<nazwa_pliku>/<nr_kanau>[,<nr_kanau>...]/<interwa_pomiarw>/<liczba_prbek>
     //
     else if (strncasecmp_P(query, PSTR("daq/start"), 9) == 0) {
 
@@ -605,8 +656,8 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
         if (result) {
             // parsuj zapytanie
             char name[9]; // 8 znakw + NULL
-            unsigned char ch;
-            unsigned int  interval, samples;
+            unsigned char mask = 0;
+            unsigned int  interval, samples, ch;
 
             char* pos;
 
@@ -618,12 +669,24 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
 
             memcpy((void*)name, (void*)query, pos-query+1);
 
-            // przesu wskanik na nr kanau
+            // przesu wskanik na list kanaw
             query = pos+1; 
 
             pos = (char*) strchr(query, '/');
             *pos = 0x00; // wpisz NULL
-            ch = atoi(query);
+
+            // kanay rozdzielone przecinkami -> maska
+            while (query) {
+                ch = atoi(query);
+
+                // ujemny numer kanau staje si du liczb bez znaku
+                if (ch < DS_DEVICES_MAX) {
+                    mask |= 1 << ch;
+                }
+
+                query = (char*) strchr(query, ',');
+                query = query ? query+1 : 0;
+            }
 
             // przesu wskanik na interwa
             query = pos+1; 
@@ -636,10 +699,13 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
             query = pos+1; 
             samples = atoi(query);
 
-            rs_text(name);rs_send('/');rs_int(ch);rs_send('/');rs_int(interval);rs_send('/');rs_int(samples);rs_newline();
+            rs_text(name);rs_send('/');rs_int(mask);rs_send('/');rs_int(interval);rs_send('/');rs_int(samples);rs_newline();
+
+            // bufor karty (koniec bufora pakietw) nadpisze nagwki odpowiedzi - wylij je wczeniej
+            len = net_tcp_flush(tcp, len, NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK);
 
             // sprbuj rozpocz zadanie akwizycji
-            result = daq_start(name, ch, interval, samples);
+            result = daq_start(name, mask, interval, samples);
         }
 
         len = net_tcp_write_data_P(tcp, len, PSTR("{\"result\":"));
@@ -652,6 +718,7 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
     else if (strncasecmp_P(query, PSTR("daq/list"), 8) == 0) {
         unsigned long sector = 1;
         fs_file fp;
+        daq_header header;
 
         ((tcp_packet*)tcp)->data[len++] = '[';
         ((tcp_packet*)tcp)->data[len++] = ' ';
@@ -672,8 +739,8 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
             len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
             ((tcp_packet*)tcp)->data[len++] = ',';
 
-            // rozmiar
-            ltoa(fp.size, buf, 10);
+            // liczba prbek (z opisu zadania)
+            ltoa( fs_read(&fp, (unsigned char*)&header, sizeof(daq_header)) ? header.samples : 0, buf, 10);
             len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
             ((tcp_packet*)tcp)->data[len++] = ',';
 
@@ -706,6 +773,9 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
         
         // sprbuj skasowa plik
         if ( fs_open(&fp, (unsigned char*)query, FS_DONT_CREATE) ) {
+            // bufor karty (koniec bufora pakietw) nadpisze dotychczasow odpowied - wylij j wczeniej
+            len = net_tcp_flush(tcp, len, NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK);
+
             fs_delete(&fp);
             ((tcp_packet*)tcp)->data[len++] = '1';
         }
@@ -716,6 +786,523 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
         ((tcp_packet*)tcp)->data[len++] = '}';
 
     }
+    //
+    // agregaty temperatur (min / max / rednia)
+    //
+    // /json/trend/0/1214870400/1215475200/64
+    //            /<nr_kanau>/<od>/<do>/<liczba_punktw>
+    //
+    // {"period":<s>,"from":<od>,"data":[[min,max,rednia],null,...]} - wartoci w dziesitych czciach stopnia
+    //
+    else if (strncasecmp_P(query, PSTR("trend/"), 6) == 0) {
+        unsigned char ch, tier;
+        unsigned long from, to, period, step;
+        unsigned int points;
+        char* pos;
+
+        trend_point point;
+        time_t time;
+
+        // parsuj zapytanie
+        query += 6;
+        ch = atoi(query);
+
+        pos = (char*) strchr(query, '/');
+        from = pos ? atol(pos+1) : 0;
+
+        pos = pos ? (char*) strchr(pos+1, '/') : 0;
+        to = pos ? atol(pos+1) : 0;
+
+        pos = pos ? (char*) strchr(pos+1, '/') : 0;
+        points = pos ? atoi(pos+1) : 0;
+
+        // domylnie do teraz
+        if (to == 0) {
+            ds1306_time_get(&time);
+            to = mktime(&time);
+        }
+
+        if ( (points == 0) || (points > WEBPAGE_TREND_POINTS_MAX) ) {
+            points = WEBPAGE_TREND_POINTS_MAX;
+        }
+
+        if ( !trend_ready || (ch >= ds_devices_count) || (from >= to) ) {
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"result\":0}"));
+            return len;
+        }
+
+        // najdokadniejszy poziom z danymi dla zakresu - punkty cz kolejne okresy poziomu
+        tier   = trend_select_tier(from, to, points);
+        period = trend_period(tier);
+
+        // dugo punktu - wielokrotno okresu poziomu
+        from -= from % period;
+        step  = ((to - from) / points + period - 1) / period * period;
+
+        if (step < period) {
+            step = period;
+        }
+
+        len = net_tcp_write_data_P(tcp, len, PSTR("{\"period\":"));
+        ltoa(step, buf, 10);
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"from\":"));
+        ltoa(from, buf, 10);
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"data\":["));
+
+        for (; from < to; from += step) {
+
+            if ( trend_query(tier, ch, from, from + step, &point) ) {
+                ((tcp_packet*)tcp)->data[len++] = '[';
+
+                itoa(point.min, buf, 10);
+                len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+                ((tcp_packet*)tcp)->data[len++] = ',';
+
+                itoa(point.max, buf, 10);
+                len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+                ((tcp_packet*)tcp)->data[len++] = ',';
+
+                itoa(point.mean, buf, 10);
+                len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+                ((tcp_packet*)tcp)->data[len++] = ']';
+            }
+            else {
+                len = net_tcp_write_data_P(tcp, len, PSTR("null"));
+            }
+
+            ((tcp_packet*)tcp)->data[len++] = ',';
+        }
+
+        // usu ostatni przecinek
+        if ( ((tcp_packet*)tcp)->data[len-1] == ',' ) {
+            len--;
+        }
+
+        ((tcp_packet*)tcp)->data[len++] = ']';
+        ((tcp_packet*)tcp)->data[len++] = '}';
+    }
+    //
+    // wyzwalacze rejestracji zdarze
+    //
+    // /json/trigger/0/d2,a,850,10,60,1,grzalka - ustaw (kana ds #2 > 85.0C, 10 prbek przed, 60 po, co 1 s)
+    // /json/trigger/0                          - wycz
+    // /json/trigger                            - lista
+    //
+    else if (strncasecmp_P(query, PSTR("trigger"), 7) == 0) {
+        unsigned char n;
+        daq_trigger* trig;
+
+        // ustaw / wycz wyzwalacz
+        if (query[7] == '/') {
+            char* pos = (char*) strchr(query, ' ');
+            *pos = 0;
+
+            n = atoi(query+8);
+            pos = (char*) strchr(query+8, '/');
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"result\":"));
+            ((tcp_packet*)tcp)->data[len++] = '0' + daq_trigger_set(n, pos ? pos+1 : 0);
+            ((tcp_packet*)tcp)->data[len++] = '}';
+
+            return len;
+        }
+
+        ((tcp_packet*)tcp)->data[len++] = '[';
+
+        for (n = 0; n < DAQ_TRIGGERS_MAX; n++) {
+            trig = &daq_triggers[n];
+
+            if (trig->source == DAQ_TRIGGER_OFF) {
+                len = net_tcp_write_data_P(tcp, len, PSTR("null,"));
+                continue;
+            }
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"src\":\""));
+            ((tcp_packet*)tcp)->data[len++] = trig->source;
+            ((tcp_packet*)tcp)->data[len++] = '0' + trig->ch;
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("\",\"type\":\""));
+            ((tcp_packet*)tcp)->data[len++] = trig->type;
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("\",\"level\":"));
+            itoa(trig->level, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"pre\":"));
+            itoa(trig->pre, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"post\":"));
+            utoa(trig->post, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"interval\":"));
+            utoa(trig->interval, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"name\":\""));
+            len = net_tcp_write_data(tcp, len, (unsigned char*)trig->name);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("\",\"state\":"));
+            ((tcp_packet*)tcp)->data[len++] = '0' + trig->state;
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"events\":"));
+            itoa(trig->events, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            ((tcp_packet*)tcp)->data[len++] = '}';
+            ((tcp_packet*)tcp)->data[len++] = ',';
+        }
+
+        // zastp ostatni przecinek
+        ((tcp_packet*)tcp)->data[len-1] = ']';
+    }
+    //
+    // strefy regulacji PID
+    //
+    // /json/pid/0/2,1,650,640,742,410 - ustaw (czujnik #2, kana PWM #1, 65.0C, P, I, D x 128)
+    // /json/pid/0/2,1,650             - ustaw (dotychczasowe wsp.)
+    // /json/pid/0                     - wycz
+    // /json/pid                       - lista (null - strefa wyczona, czasy w us)
+    //
+    else if (strncasecmp_P(query, PSTR("pid"), 3) == 0) {
+        unsigned char z;
+
+        // ustaw / wycz stref
+        if (query[3] == '/') {
+            char* pos = (char*) strchr(query, ' ');
+            *pos = 0;
+
+            z = atoi(query+4);
+            pos = (char*) strchr(query+4, '/');
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"result\":"));
+            ((tcp_packet*)tcp)->data[len++] = '0' + pid_zone_set(z, pos ? pos+1 : 0);
+            ((tcp_packet*)tcp)->data[len++] = '}';
+
+            return len;
+        }
+
+        ((tcp_packet*)tcp)->data[len++] = '[';
+
+        for (z = 0; z < PID_COUNT; z++) {
+            if ( !pid_zone_enabled(z) ) {
+                len = net_tcp_write_data_P(tcp, len, PSTR("null,"));
+                continue;
+            }
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"ds\":"));
+            ((tcp_packet*)tcp)->data[len++] = '0' + my_config.pid_sensor[z];
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"pwm\":"));
+            ((tcp_packet*)tcp)->data[len++] = '0' + my_config.pid_pwm[z];
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"sp\":"));
+            itoa(my_config.pid_sp[z], buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"pv\":"));
+            itoa(ds_temp[ my_config.pid_sensor[z] ], buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"gains\":["));
+            for (n = 0; n < 3; n++) {
+                utoa(my_config.pid_gains[z][n], buf, 10);
+                len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+                ((tcp_packet*)tcp)->data[len++] = ',';
+            }
+            ((tcp_packet*)tcp)->data[len-1] = ']';
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"out\":"));
+            itoa(pid_zones[z].output, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+#ifdef PERF
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"exec\":"));
+            utoa(pid_zones[z].exec, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"exec_max\":"));
+            utoa(pid_zones[z].exec_max, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"jitter\":"));
+            utoa(pid_zones[z].jitter, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"jitter_max\":"));
+            utoa(pid_zones[z].jitter_max, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+#endif
+
+            ((tcp_packet*)tcp)->data[len++] = '}';
+            ((tcp_packet*)tcp)->data[len++] = ',';
+        }
+
+        // zastp ostatni przecinek
+        ((tcp_packet*)tcp)->data[len-1] = ']';
+    }
+    //
+    // strojenie przekanikowe strefy PID
+    //
+    // /json/tune/0/z,255,5 - strefa #0, regua Zieglera-Nicholsa, przekanik 0/255, histereza 0.5C
+    // /json/tune/0         - przerwij
+    // /json/tune           - stan (nastawy strefy po zakoczeniu - /json/pid)
+    //
+    else if (strncasecmp_P(query, PSTR("tune"), 4) == 0) {
+
+        if (query[4] == '/') {
+            char* pos = (char*) strchr(query, ' ');
+            *pos = 0;
+
+            pos = (char*) strchr(query+5, '/');
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"result\":"));
+            ((tcp_packet*)tcp)->data[len++] = '0' + pid_tune_start(atoi(query+5), pos ? pos+1 : 0);
+            ((tcp_packet*)tcp)->data[len++] = '}';
+
+            return len;
+        }
+
+        len = net_tcp_write_data_P(tcp, len, PSTR("{\"zone\":"));
+        itoa((pid_tune.zone == 0xff) ? -1 : pid_tune.zone, buf, 10);
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"state\":"));
+        ((tcp_packet*)tcp)->data[len++] = '0' + pid_tune.state;
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"cycles\":"));
+        ((tcp_packet*)tcp)->data[len++] = '0' + pid_tune.cycles;
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"ku\":"));
+        utoa(pid_tune.ku, buf, 10);
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"tu\":"));
+        ultoa(pid_tune.tu, buf, 10);
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        ((tcp_packet*)tcp)->data[len++] = '}';
+    }
+    //
+    // zadania planisty ptli gwnej (okres i termin w taktach 25 ms, czasy w us)
+    //
+    // /json/sched
+    //
+    else if (strncasecmp_P(query, PSTR("sched"), 5) == 0) {
+        ((tcp_packet*)tcp)->data[len++] = '[';
+
+        for (n = 0; n < sched_count; n++) {
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"name\":\""));
+            len = net_tcp_write_data_P(tcp, len, sched_task_name(n));
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("\",\"period\":"));
+            utoa(pgm_read_word(&sched_tasks[n].period), buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"deadline\":"));
+            utoa(pgm_read_word(&sched_tasks[n].deadline), buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+#ifdef PERF
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"runs\":"));
+            utoa(sched_states[n].runs, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"exec\":"));
+            utoa(sched_states[n].exec, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"exec_max\":"));
+            ultoa(sched_states[n].exec_max, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+#endif
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"overruns\":"));
+            utoa(sched_states[n].overruns, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            ((tcp_packet*)tcp)->data[len++] = '}';
+            ((tcp_packet*)tcp)->data[len++] = ',';
+        }
+
+        // zastp ostatni przecinek
+        ((tcp_packet*)tcp)->data[len-1] = ']';
+    }
+#ifdef PERF
+    //
+    // czasy obsugi przerwa i zada planisty (us) i histogramy opnie startu (PERF_BINS)
+    //
+    // /json/perf       - statystyki
+    // /json/perf/clear - zeruj
+    //
+    else if (strncasecmp_P(query, PSTR("perf"), 4) == 0) {
+        perf_record rec;
+
+        if (strncasecmp_P(query+4, PSTR("/clear"), 6) == 0) {
+            perf_clear();
+
+            return net_tcp_write_data_P(tcp, len, PSTR("{\"result\":1}"));
+        }
+
+        ((tcp_packet*)tcp)->data[len++] = '[';
+
+        for (n = 0; n < PERF_ISRS + sched_count; n++) {
+            perf_get(n, &rec);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"name\":\""));
+            len = net_tcp_write_data_P(tcp, len, perf_name(n));
+
+            len = net_tcp_write_data_P(tcp, len, PSTR("\",\"min\":"));
+            utoa(rec.min, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"mean\":"));
+            utoa(rec.mean, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"max\":"));
+            utoa(rec.max, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"latency\":["));
+            for (unsigned char bin = 0; bin < PERF_BINS; bin++) {
+                utoa(rec.latency[bin], buf, 10);
+                len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+                ((tcp_packet*)tcp)->data[len++] = ',';
+            }
+            ((tcp_packet*)tcp)->data[len-1] = ']';
+
+            ((tcp_packet*)tcp)->data[len++] = '}';
+            ((tcp_packet*)tcp)->data[len++] = ',';
+        }
+
+        // zastp ostatni przecinek
+        ((tcp_packet*)tcp)->data[len-1] = ']';
+    }
+#endif
+    //
+    // /json/series?ch=0&from=1214870400&to=1215475200[&next=<rekord>&sample=<prbka>]
+    //
+    // {"from":<od>,"data":[[<czas od pocztku zakresu>,<warto>],...],"next":<rekord lub -1>,"sample":<prbka>}
+    //
+    // ramki zada o rnych okresach przeplataj si w dzienniku, wic prbki nie s uporzdkowane
+    // wg czasu - kolejna odpowied wznawiana jest od pozycji w dzienniku (rekord i prbka ramki)
+    //
+    else if (strncasecmp_P(query, PSTR("series?"), 7) == 0) {
+        unsigned char ch, count = 0, sample = 0, more = 0;
+        unsigned long from, to, timestamp, next = 0;
+        signed int value;
+        char* param;
+
+        journal_cursor cur;
+        time_t time;
+
+        // parsuj zapytanie
+        param = webpage_get_param(query, PSTR("ch"));
+        ch = param ? atoi(param) : 0;
+
+        param = webpage_get_param(query, PSTR("from"));
+        from = param ? atol(param) : 0;
+
+        param = webpage_get_param(query, PSTR("to"));
+        to = param ? atol(param) : 0;
+
+        param = webpage_get_param(query, PSTR("next"));
+        next = param ? atol(param) : 0;
+
+        param = webpage_get_param(query, PSTR("sample"));
+        sample = param ? atoi(param) : 0;
+
+        // domylnie do teraz
+        if (to == 0) {
+            ds1306_time_get(&time);
+            to = mktime(&time);
+        }
+
+        if ( !journal_is_ready() || (ch >= DS_DEVICES_MAX) || (from > to) ) {
+            len = net_tcp_write_data_P(tcp, len, PSTR("{\"result\":0}"));
+            return len;
+        }
+
+        len = net_tcp_write_data_P(tcp, len, PSTR("{\"from\":"));
+        ltoa(from, buf, 10);
+        len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+        len = net_tcp_write_data_P(tcp, len, PSTR(",\"data\":["));
+
+        // wyszukiwanie binarne sektorw dziennika obejmujcych pocztek zakresu / wznowienie
+        if ( webpage_get_param(query, PSTR("next")) ) {
+            journal_cursor_init(&cur, next, ch);
+        }
+        else {
+            journal_cursor_seek(&cur, ch, from);
+        }
+
+        while ( journal_cursor_next(&cur, &value, &timestamp) ) {
+
+            // prbki ramki wysane w poprzedniej odpowiedzi
+            if ( (cur.rec.seq == next) && (cur.sample <= sample) ) {
+                continue;
+            }
+
+            if (timestamp > to) {
+                if ( journal_cursor_past(&cur, to) ) {
+                    break;
+                }
+
+                continue;
+            }
+
+            if (timestamp < from) {
+                continue;
+            }
+
+            // pakiet peny - klient dopyta od tej prbki
+            if (count == WEBPAGE_SERIES_SAMPLES_MAX) {
+                more = 1;
+                break;
+            }
+
+            ((tcp_packet*)tcp)->data[len++] = '[';
+
+            ltoa(timestamp - from, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+            ((tcp_packet*)tcp)->data[len++] = ',';
+
+            itoa(value, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+            ((tcp_packet*)tcp)->data[len++] = ']';
+            ((tcp_packet*)tcp)->data[len++] = ',';
+
+            count++;
+        }
+
+        // usu ostatni przecinek
+        if ( ((tcp_packet*)tcp)->data[len-1] == ',' ) {
+            len--;
+        }
+
+        len = net_tcp_write_data_P(tcp, len, PSTR("],\"next\":"));
+
+        if (more) {
+            ultoa(cur.rec.seq, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+
+            len = net_tcp_write_data_P(tcp, len, PSTR(",\"sample\":"));
+            itoa(cur.sample - 1, buf, 10);
+            len = net_tcp_write_data(tcp, len, (unsigned char*)buf);
+        }
+        else {
+            len = net_tcp_write_data_P(tcp, len, PSTR("-1,\"sample\":0"));
+        }
+
+        ((tcp_packet*)tcp)->data[len++] = '}';
+    }
     else {
         return 0;
     }
@@ -724,3 +1311,26 @@ unsigned int webpage_get_json_content(char* query, void* tcp)
 
     return len;
 }
+
+char* webpage_get_param(char* query, PGM_P name) {
+
+    unsigned char n = strlen_P(name);
+
+    // parametry zaczynaj si po '?' - kocz na spacji (przed "HTTP/1.x")
+    query = strchr(query, '?');
+
+    while (query && *query && *query != ' ') {
+        query++;
+
+        if ( (strncmp_P(query, name, n) == 0) && (query[n] == '=') ) {
+            return query + n + 1;
+        }
+
+        // kolejny parametr
+        while (*query && *query != '&' && *query != ' ') {
+            query++;
+        }
+    }
+
+    return 0;
+}
@@ -10,6 +10,15 @@ extern const char WEBPAGE_SERVER[] PROGMEM;
 #define WEBPAGE_PORT      80
 #define WEBPAGE_PORT_ALT  8080
 
+// maksymalna dlugosc analizowanej linii zadania HTTP
+#define WEBPAGE_QUERY_MAX 64
+
+// maksymalna liczba punktw w odpowiedzi /json/trend
+#define WEBPAGE_TREND_POINTS_MAX  64
+
+// maksymalna liczba prbek w odpowiedzi /json/series
+#define WEBPAGE_SERIES_SAMPLES_MAX  64
+
 // obsluguje zadanie HTTP zwracajac tresc pakietu zwrotnego i jego dlugosc
 unsigned int webpage_handle_http(void*, unsigned char*);
 
@@ -50,9 +59,15 @@ unsigned int webpage_print_header(void*, unsigned int);
 // wstaw stopk
 unsigned int webpage_print_footer(void*, unsigned int);
 
+// wstaw zawarto sektora pamici EEPROM (wysyana w kolejnych segmentach TCP)
+unsigned int webpage_print_sector(void*, unsigned int, unsigned char);
+
 
 
 // pobierz zawartosc generowana dynamicznie (/json/...)
 unsigned int webpage_get_json_content(char*, void*);
 
+// znajd warto parametru <nazwa>=... w czci zapytania po '?' (zwraca 0 gdy brak)
+char* webpage_get_param(char*, PGM_P);
+
 #endif
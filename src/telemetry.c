@@ -36,26 +36,22 @@ void init_interrupts()
     //
     // PWM DRIVER: przerwanie od timera0
     //
-    OCR0 = 0x80;                            // ~ 2 ms
+    OCR0 = 0x80;                            // pierwsze przerwanie rozpoczyna okres (kolejne w chwilach zboczy)
     TIMSK |= (1 << OCIE0);                  // przerwanie od Output Compare (TCNT0 == OCR0)
     TCCR0 |= (1 << WGM01);                  // Clear Timer on Compare (CTC)
-    TCCR0 |= (1 << CS02) | (1 << CS12);     // preskaler CK/1024
+    TCCR0 |= (1 << CS02) | (1 << CS00);     // preskaler CK/1024
     TCNT0 = 0x00;                           // zeruj zegar
 
     //
     // POOLING: przerwanie od timera1
     //
-    TIMSK |= (1 << TOIE1);	// Timer Overflow Interrupt Enabled
-
-	TCCR1B |= (1 << CS10) | (1 << CS12);	// preskaler CK/1024
-
-	// Preskaler: 1MHz / 1024 ~ 976,56 Hz
-	//
-	// x taktow => 125 ms
-	// 1 takt   => 0,00102 s ~ 1 ms
-
-	// odlicz czas (25 ms)
-    TCNT1   = 0xffff - 25*16; // 16 MHz
+    // Preskaler: 16 MHz / 8 -> 0,5 us na takt (Output Compare B odmierza szczeliny 1wire)
+    //
+    // CTC: licznik zerowany po 50000 taktach (25 ms)
+    OCR1A  = (F_CPU / 8 / 40) - 1;
+    TCNT1  = 0;
+    TCCR1B |= (1 << WGM12) | (1 << CS11);
+    TIMSK  |= (1 << OCIE1A);	// przerwanie od Output Compare A (TCNT1 == OCR1A)
 
     //
     // DS1306: przerwanie zboczem 1->0 na INT0
@@ -82,99 +78,211 @@ void init_interrupts()
 // aktualizacja wyj sterownika PWM
 ISR(SIG_OUTPUT_COMPARE0)
 {
+    // licznik wyzerowany w chwili dopasowania (CTC)
+    perf_enter(TCNT0 << 6);
+
     pwm_loop();
+
+    perf_exit(PERF_PWM);
+}
+
+// ----------------------------------------------------------------------------------------------------------------
+// przerwanie od CTC Timera2
+//
+// wyzwolenie kolejnego przetwarzania ADC (tryb ADC_MODE_TIMER)
+ISR(SIG_OUTPUT_COMPARE2)
+{
+    adc_on_timer();
+}
+
+// ----------------------------------------------------------------------------------------------------------------
+// przerwanie od zakoczenia przetwarzania ADC
+//
+// zapis wyniku do bufora bloku, wybr kolejnego kanau z listy
+ISR(SIG_ADC)
+{
+    perf_enter(0);
+
+    adc_on_conversion();
+
+    perf_exit(PERF_ADC);
 }
 
 
 
 // ----------------------------------------------------------------------------------------------------------------
-// przerwanie od przepelnienia Timera1 (co 25 ms)
+// przerwanie od Output Compare B Timera1
 //
-// w trybie poolingu:
-//  * aktualizuj wartosci temperatur z czujnikow
-//  * aktualizuj czas na wysw. LCD
-ISR(SIG_OVERFLOW1)
+// kolejna faza transakcji 1wire
+ISR(SIG_OUTPUT_COMPARE1B)
 {
-    // odliczaj kolejny okres
-    TCNT1   = 0xffff - 25*16;   // 16 MHz
+    perf_enter( ((TCNT1 < OCR1B) ? TCNT1 + OCR1A + 1 - OCR1B : TCNT1 - OCR1B) >> 1 );
 
-    // pytaj okresowo o czas
-    static unsigned int last_ntp_update;
+    ow_on_timer();
 
-    // odbior danych z RS'a
-    if (rs_has_recv()) {
-        on_rs_cmd( rs_recv() );
-    }
+    perf_exit(PERF_OW);
+}
+
+// ----------------------------------------------------------------------------------------------------------------
+// przerwanie od CTC Timera1 (co 25 ms)
+//
+//  * licznik taktw planisty zada ptli gwnej
+//  * pomiary temperatur i regulatory PID (stay takt niezaleny od obcienia ptli gwnej)
+ISR(SIG_OUTPUT_COMPARE1A)
+{
+    perf_enter(TCNT1 >> 1);
+
+    pooling_ticks++;
+
+    // DS18B20: pomiary kanaw wg ich okresw prbkowania (transakcje 1wire w tle)
+    ds18b20_pooling();
+
+    perf_exit(PERF_POOLING);
+}
 
-    // ENC28: sprawd czy nie ma w buforze kolejnych pakietw do obsuenia
+
+// ----------------------------------------------------------------------------------------------------------------
+// zadania okresowe (wykonywane w ptli gwnej przez planist - przerwania nie czekaj na ich zakoczenie)
+
+// ADC: zapisz peny blok prbek
+void task_adc()
+{
+    adc_pooling();
+}
+
+// ENC28: obsu pakiet z bufora (zgoszenie przerwaniem INT1, co takt na wypadek zgubionego zbocza)
+void task_net()
+{
     if (enc28_count_packets() > 0) {
         on_int1();
+
+        // kolejne pakiety w buforze - obsu w nastpnym przebiegu ptli
+        if (enc28_count_packets() > 0) {
+            sched_trigger(TASK_NET);
+        }
+    }
+}
+
+// odbior danych z RS'a
+void task_rs()
+{
+    if (rs_has_recv()) {
+        on_rs_cmd( rs_recv() );
     }
 
-    // skanuj przyciski klawiatury
+    // zdarzenia czujnikw DS18B20 z przerwa
+    ds18b20_report();
+}
+
+// skanuj przyciski klawiatury
+void task_keys()
+{
     keys_scan();
 
     if ( keys_pressed() ) {
         // aktualizuj menu wg wybranego przycisku
         menu_handle_keys();
+        menu_update();
     }
+}
 
+// aktualizuj wskazania menu
+void task_lcd()
+{
+    menu_update();
+}
 
-    //
-    // pooling
-    //
+void task_daq()
+{
+    // akwizycja danych na kart pamici
+    daq_pooling();
 
-    // zwiksz co 25 ms
-    if (pooling_step++ > 40) {
-        pooling_step = 0;
-    }
-    if (pooling_step % 5)
-        return;
+    // rozelij pene paczki pomiarw subskrybentom i do grupy multicast
+    stream_pooling();
 
-    // wybierz krok poolingu do obsluzenia
-    switch((pooling_step/5)%8) {
+    // zgoszenia czonkostwa w grupie multicast
+    net_igmp_pooling(net_packet);
+}
 
-        case 0:
-        //case 4:
-            // odczyt temperatury z wszystkich czujnikow
-            ds18b20_get_temperature_from_all();
+// dolicz pomiary do agregatw minutowych / godzinowych (czujniki odczytywane w tle)
+void task_trend()
+{
+    trend_update();
+}
 
-            // wylij zadanie kolejnego pomiaru temperatury do wszystkich czujnikow ds18b20
-            ds18b20_request_measure();
+void task_ntp()
+{
+    // pytaj okresowo o czas
+    static unsigned int last_ntp_update;
 
-            break;
+    // brak MAC'a bramy? -> nie wylemy pakietu w wiat
+    if (my_net_config.gate_mac[0] == 0xff)
+        return;
 
-        case 2:
-            // akwizycja danych na kart pamici
-            daq_pooling();
-            break;
+    // proba aktualizacji timera NTP ?
+    if (last_ntp_update == 0) {
+        net_ntp_get_time(net_packet);
 
-        case 3:
-            // brak MAC'a bramy? -> nie wylemy pakietu w wiat
-            if (my_net_config.gate_mac[0] == 0xff)
-                break;
+        last_ntp_update = 0xffff - (15*60); // odswiezaj czas co 15 minut
 
-            // proba aktualizacji timera NTP ?
-            if (last_ntp_update == 0) {
-                net_ntp_get_time(net_packet);
+        rs_text_P(PSTR("NTP: wyslane zapytanie")); rs_newline();
+    }
 
-                last_ntp_update = 0xffff - (15*60); // odswiezaj czas co 15 minut
+    last_ntp_update++;
+}
 
-                rs_text_P(PSTR("NTP: wyslane zapytanie")); rs_newline();
-            }
+// ustawienia zmienione w przerwaniach i poleceniach (przypisania czujnikw, strefy PID) - zapis EEPROM
+// po bajcie na przebieg (zapis caoci trwa ok. 1 s - zadania nie mog na niego czeka)
+void task_config()
+{
+    // kolejna zmiana w trakcie zapisu - porwnuj od pocztku
+    if (config_changed) {
+        config_changed = 0;
+        config_save_pos = 0;
+    }
 
-            last_ntp_update++;
+    config_save_step(&my_config);
+}
 
-            break;
-    }
+const char task_adc_name[] PROGMEM =    "adc";
+const char task_net_name[] PROGMEM =    "net";
+const char task_rs_name[] PROGMEM =     "rs";
+const char task_keys_name[] PROGMEM =   "keys";
+const char task_lcd_name[] PROGMEM =    "lcd";
+const char task_daq_name[] PROGMEM =    "daq";
+const char task_trend_name[] PROGMEM =  "trend";
+const char task_ntp_name[] PROGMEM =    "ntp";
+const char task_config_name[] PROGMEM = "config";
+
+// kolejno wg TASK_* (telemetry.h)
+//
+// nazwa, funkcja, okres, faza, termin (takty 25 ms), priorytet
+const sched_task tasks[] PROGMEM = {
+    {task_adc_name,     task_adc,       1,  0,  1,  0},
+    {task_net_name,     task_net,       1,  0,  2,  1},
+    {task_rs_name,      task_rs,        1,  0,  4,  2},
+    {task_keys_name,    task_keys,      1,  0,  4,  2},
+    {task_lcd_name,     task_lcd,       10, 5,  10, 3},
+    {task_daq_name,     task_daq,       40, 10, 20, 4},
+    {task_trend_name,   task_trend,     40, 0,  40, 5},
+    {task_ntp_name,     task_ntp,       40, 15, 40, 6},
+    {task_config_name,  task_config,    1,  0,  4,  7},
+};
 
-    // aktualizuj wskazania menu
-    //
-    // po wciniciu przycisku i co 250 ms
-    if ( keys_pressed() || ((pooling_step%10) == 0) ) {
-        menu_update();
+
+// czas od startu w us
+unsigned long pooling_time_us()
+{
+    unsigned long ticks = pooling_ticks;
+    unsigned int count = TCNT1;
+
+    // licznik wyzerowany (CTC), a przerwanie jeszcze nieobsuone
+    if (TIFR & (1 << OCF1A)) {
+        ticks++;
+        count = TCNT1;
     }
-    
+
+    return ticks * 25000UL + (count >> 1);
 }
 
 
@@ -189,13 +297,15 @@ ISR(SIG_INTERRUPT0)
 // przerwania zboczem opadajacym na INT1 (odbior pakietow z ENC28)
 ISR(SIG_INTERRUPT1)
 {
-    on_int1();
+    perf_enter(0);
+
+    sched_trigger(TASK_NET);
+
+    perf_exit(PERF_INT1);
 }
 
 void on_int1()
 {
-    cli();
-
     // dlugosc odebranego pakietu
     unsigned int len;
 
@@ -203,11 +313,10 @@ void on_int1()
     ethernet_packet* eth_packet;
         
     // odbierz i "parsuj" pakiet
-    len = enc28_packet_recv(net_packet, ENC28_MAX_FRAMELEN);
+    len = enc28_packet_recv(net_packet, NET_PACKET_LEN);
 
     // niczego nie odebralismy
     if (len == 0) {
-        sei();
         return;
     }
 
@@ -252,7 +361,22 @@ void on_int1()
 
                 // DAQ
                 case DAQ_PORT:
-                    len = daq_handle_packet(udp_data);
+                    // dugo z nagwka UDP musi mieci si w odebranej ramce
+                    if ( (HTONS(((udp_packet*) ip_data)->length) < sizeof(udp_packet)) || (HTONS(((udp_packet*) ip_data)->length) > len - (ip_data - net_packet)) ) {
+                        len = 0;
+                        break;
+                    }
+
+                    // zakocz dane znakiem NULL (polecenia tekstowe z parametrami) - najdalej na kocu ramki (len < NET_PACKET_LEN)
+                    udp_data[HTONS(((udp_packet*) ip_data)->length) - sizeof(udp_packet)] = 0;
+
+                    // subskrypcje strumienia - potrzebny adres nadawcy
+                    if (udp_data[0] == STREAM_CMD) {
+                        len = stream_handle_packet(eth_packet->src, ip->src_addr, HTONS(((udp_packet*) ip_data)->src_port), udp_data);
+                    }
+                    else {
+                        len = daq_handle_packet(udp_data);
+                    }
                     break;
 
 
@@ -289,8 +413,12 @@ void on_int1()
                     len = 0;
             }
 
-            if (len > 0)
-                len = net_make_tcp_packet(((tcp_packet*) ip_data), NET_TCP_FLAG_FIN | NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK, port, HTONS(((tcp_packet*) ip_data)->src_port), NULL, len);
+            // ostatni (lub jedyny) segment odpowiedzi zamyka poczenie - wczeniejsze wysaa obsuga zapytania
+            if ( (len > 0) || net_tcp_sending ) {
+                net_tcp_flush((tcp_packet*) ip_data, len, NET_TCP_FLAG_FIN | NET_TCP_FLAG_PUSH | NET_TCP_FLAG_ACK);
+            }
+
+            len = 0;
         
         }
         // bledne zadanie
@@ -307,8 +435,6 @@ void on_int1()
             rs_newline(); //rs_send('<');rs_int(len);rs_newline();
         }
     }
-
-    sei();
 }
 
 // obsluga komend z terminala RS
@@ -368,6 +494,41 @@ void on_rs_cmd(unsigned char cmd)
             rs_newline();
             break;
 
+        // zadania planisty
+        case 's':
+            for (unsigned char n=0; n<sched_count; n++) {
+                rs_text_P(sched_task_name(n)); rs_send('\t');
+#ifdef PERF
+                rs_long(sched_states[n].runs);      rs_send(' ');
+                rs_long(sched_states[n].exec);      rs_text_P(PSTR("us max "));
+                rs_long(sched_states[n].exec_max);  rs_text_P(PSTR("us "));
+#endif
+                rs_text_P(PSTR("po terminie "));
+                rs_long(sched_states[n].overruns);  rs_newline();
+            }
+            break;
+
+#ifdef PERF
+        // czasy obsugi przerwa i zada: min / redni / maks. (us), histogram opnie startu
+        case 'l':
+            for (unsigned char n=0; n<PERF_ISRS+sched_count; n++) {
+                perf_record rec;
+
+                perf_get(n, &rec);
+
+                rs_text_P(perf_name(n)); rs_send('\t');
+                rs_long(rec.min);   rs_send('/');
+                rs_long(rec.mean);  rs_send('/');
+                rs_long(rec.max);   rs_text_P(PSTR("us\t"));
+
+                for (unsigned char bin=0; bin<PERF_BINS; bin++) {
+                    rs_long(rec.latency[bin]); rs_send(' ');
+                }
+                rs_newline();
+            }
+            break;
+#endif
+
         // DHCP
         /*
         case 'd':
@@ -380,9 +541,13 @@ void on_rs_cmd(unsigned char cmd)
             rs_text_P(PROGRAM_NAME);    rs_newline(); rs_newline();
 
             rs_text_P(PSTR("k - konfiguracja systemu"));        rs_newline();
+#ifdef PERF
+            rs_text_P(PSTR("l - czasy obslugi przerwan i zadan")); rs_newline();
+#endif
             rs_text_P(PSTR("n - ustawienia stosu TCP/IP"));     rs_newline();
             rs_text_P(PSTR("p - wypelnienia kanalow PWM"));     rs_newline();
             rs_text_P(PSTR("r - reset systemu"));               rs_newline();
+            rs_text_P(PSTR("s - zadania planisty"));            rs_newline();
             rs_text_P(PSTR("t - pomiary temperatur"));          rs_newline();
             rs_text_P(PSTR("u - uptime systemu"));              rs_newline();
     }
@@ -428,6 +593,10 @@ void init_peripherals()
     pwm_init();
     lcd_char(lcd_block);
 
+    // -----------------------------------------------------------------------------------------
+    // ADC (uruchamiany na danie)
+    adc_init();
+
     // -----------------------------------------------------------------------------------------
     // odczyt ustawie z pamici EEPROM
     rs_text_P(PSTR("EEPROM: "));
@@ -464,7 +633,30 @@ void init_peripherals()
         my_config.config = 0;
 
         // przypisania czujnikw DS do kanaw
-        memset((void*) (my_config.ds_assignment), 0, DS_DEVICES_MAX);
+        memset((void*) (my_config.ds_rom), 0, sizeof(my_config.ds_rom));
+
+        // prbkowanie co sekund (rozdzielczo 12 bitw)
+        memset((void*) (my_config.ds_period), 0, DS_DEVICES_MAX);
+        memset((void*) (my_config.ds_alarm_low), 0, DS_DEVICES_MAX);
+        memset((void*) (my_config.ds_alarm_high), 0, DS_DEVICES_MAX);
+
+        // wejcia ADC bez decymacji
+        memset((void*) (my_config.adc_decimation), 0, 8);
+
+        // bez publikacji multicast
+        memset((void*) (my_config.mcast_group), 0, sizeof(ip_addr));
+        my_config.mcast_interval = 0;
+
+        // strefy PID wyczone (sterowanie rczne kanaami PWM)
+        memset((void*) (my_config.pid_sensor), 0xff, PID_COUNT);
+        memset((void*) (my_config.pid_pwm), 0xff, PID_COUNT);
+        memset((void*) (my_config.pid_sp), 0, sizeof(my_config.pid_sp));
+
+        for (i=0; i < PID_COUNT; i++) {
+            my_config.pid_gains[i][0] = 5.0*PID_SCALING_FACTOR;
+            my_config.pid_gains[i][1] = 5.8*PID_SCALING_FACTOR;
+            my_config.pid_gains[i][2] = 3.2*PID_SCALING_FACTOR;
+        }
 
         config_save(&my_config);
 
@@ -475,11 +667,8 @@ void init_peripherals()
     lcd_char(lcd_block);
 
     // -----------------------------------------------------------------------------------------
-    // PID
-    /*
-    for (i=0; i < PID_COUNT; i++)
-        pid_init(&pid[i], 5.0*PID_SCALING_FACTOR, 5.8*PID_SCALING_FACTOR, 3.2*PID_SCALING_FACTOR);
-    */
+    // PID (strefy uruchamiane po odczycie ich czujnikw)
+    pid_zones_init();
 
     // -----------------------------------------------------------------------------------------
     // SPI
@@ -517,8 +706,9 @@ void init_peripherals()
         }
 
         // system plikw (FS) -> ustaw jako bufor operacji I/O koniec bufora na ramk ethernetow
+        // (jeden bufor sektora dla FS, FAT, dziennika i agregatw - aden nie trzyma w nim danych midzy wywoaniami)
         //
-        if ( fs_init(net_packet+1000) ) {
+        if ( fs_init(NET_PACKET_SD_BUF) ) {
         /**
             fs_file fp;
             unsigned char data;
@@ -536,29 +726,21 @@ void init_peripherals()
         **/
         }
 
-        // inicjalizacja FAT'a
-        /*
-        if ( fat_init(&fat, net_packet+512) ) {
+        // inicjalizacja FAT'a (bufor wspdzielony z FS)
+        if ( fat_init(&fat, NET_PACKET_SD_BUF) ) {
             rs_send(' ');
             rs_text((char*)fat.name);
+        }
 
-            // test otwarcia pliku
-            fat_file fp;
-
-            // test.txt
-            fat_file_open(&fp, (unsigned char*)"test    ", (unsigned char*)"txt");
-            rs_int(fp.size);
-
-            // INDEX~1.HTM
-            fat_file_open(&fp, (unsigned char*)"index~1 ", (unsigned char*)"htm");
-            rs_int(fp.size);
-        
+        // dziennik pomiarw (bufor wspdzielony z FS) - odtwrz koniec dziennika
+        if ( journal_init(NET_PACKET_SD_BUF) ) {
+            rs_text_P(PSTR(" journal #")); rs_long(journal_seq);
+        }
 
-            // __teleme.try
-            fat_file_open(&fp, (unsigned char*)"__teleme", (unsigned char*)"try");
-            rs_int(fp.size);
+        // agregaty temperatur (bufor wspdzielony z FS)
+        if ( trend_init(NET_PACKET_SD_BUF) ) {
+            rs_text_P(PSTR(" trend"));
         }
-        */
     }
     // bd
     else {
@@ -596,6 +778,8 @@ void init_peripherals()
 
     // -----------------------------------------------------------------------------------------
     // 1wire - DS18B20
+    ow_init();
+
     unsigned char ow_slave_present = ow_reset();
 
     rs_newline();
@@ -618,7 +802,11 @@ void init_peripherals()
         for (tmp=1; tmp < 7; tmp++)
             rs_hex(ds_devices[i][tmp]);
 
-        rs_send(' '); rs_send('@'); rs_int(my_config.ds_assignment[i]);
+        rs_send(' '); rs_send('/'); rs_int(ds_bus[i]);
+
+        if ( !(ds_present & (1 << i)) ) {
+            rs_text_P(PSTR(" (brak)"));
+        }
 
         rs_newline();
     }
@@ -665,11 +853,14 @@ int main()
 
     // inicjalizacja zmiennych globalnych
     uptime = 0;
-    pooling_step = 0;
 
     init_peripherals(); // ukady peryferyjne
     init_interrupts();  // przerwania
 
+    // zadania okresowe ptli gwnej
+    sched_init(tasks, sizeof(tasks) / sizeof(sched_task));
+    perf_clear();
+
     // od teraz przyjmuj zgloszenia przerwan...
     sei(); 
 
@@ -687,8 +878,15 @@ int main()
         net_arp_ask((ip_addr*) my_net_config.gate_ip, (ethernet_packet*) net_packet);
     }
 
-    // czekaj na zgloszenia przerwan i zajmuj sie ich obsluga
-    for(;;);
+    // grupa multicast publikowanych pomiarw (zgoszenia IGMP wysyane z poolingu)
+    if ( my_config.mcast_interval && net_is_multicast(my_config.mcast_group) ) {
+        net_igmp_join(my_config.mcast_group);
+    }
+
+    // wykonuj kolejne gotowe zadania (przerwania zajmuj si tylko pomiarami i PWM)
+    for(;;) {
+        sched_run();
+    }
 
     return 1;
 }
@@ -33,7 +33,29 @@
 // sterownik PWM
 //
 #define PWM_PORT        PORTA
-#define PWM_MASK        0xff
+#define PWM_MASK        0x3f            // PA0..PA5 - wyjcia kanaw programowych (kanay poza mask bez wyjcia na porcie)
+#define PWM_TICKS       32              // takty Timer0 (CK/1024, 64 us) na jednostk wypenienia - okres 256 jednostek (~0,5 s)
+//#define PWM_BCM                       // kanay programowe w trybie BCM (modulacja kodu binarnego) zamiast harmonogramu zboczy
+
+// przypisanie kanaw PWM do wyj: PWM_SOFT - programowo na PWM_PORT (wolne kanay grzaek),
+// PWM_OC2 - sprztowy fast PWM Timer2 na PD7 (wentylatory, SSR; wyklucza przycisk S4 i tryb ADC_MODE_TIMER)
+//
+// OC0 (PB3 - ENC28_SS, Timer0 - harmonogram PWM programowego) oraz OC1A / OC1B (Timer1 - pooling
+// i szczeliny 1wire, PD5 / PD4 - przyciski) s w tym ukadzie zajte
+#define PWM_SOFT        0
+#define PWM_OC2         1
+#define PWM_MAP         {PWM_SOFT, PWM_SOFT, PWM_SOFT, PWM_SOFT, PWM_SOFT, PWM_SOFT, PWM_SOFT, PWM_SOFT}
+#define PWM_OC2_CS      (1 << CS21)     // preskaler Timer2 CK/8 -> 16 MHz / 8 / 256 = 7,8 kHz
+
+// przetwornik ADC - wejcia PORTA (rozczne z wyjciami PWM_MASK)
+//
+#define ADC_MASK        0xc0            // PA6 (ADC6), PA7 (ADC7)
+#define ADC_REF         (1 << REFS0)    // napicie odniesienia: AVCC
+#define ADC_BLOCK_SIZE  16              // prbek w bloku (dwa bloki po 32 bajty RAM)
+
+#if (PWM_MASK & ADC_MASK)
+#error "piny PORTA przypisane jednoczenie do PWM_MASK i ADC_MASK"
+#endif
 
 // sterownik PID
 #define PID_COUNT       5
@@ -42,10 +64,55 @@
 //
 #define DS_DEVICES_MAX  8
 
+// limity tablic poniej dobrane do 2 kB RAM ATmega32 (razem z buforem pakietw i stosem)
+
+// liczba rwnolegych zada akwizycji (DAQ) - ok. 80 bajtw RAM na zadanie
+#define DAQ_TASKS_MAX   1
+
+// czna liczba kanaw rejestrowanych przez rwnolege zadania (stan kodera ramek - 4 bajty RAM na kana)
+#define DAQ_CHANNELS_MAX    8
+
+// wyzwalacze rejestracji zdarze (DAQ) i dugo bufora prbek sprzed wyzwolenia - ok. 40 bajtw RAM na wyzwalacz
+#define DAQ_TRIGGERS_MAX    1
+#define DAQ_TRIGGER_PRE_MAX 8
+
+// subskrypcje strumienia pomiarw (UDP) i dugo historii migawek do powtrze (potga dwjki, 16 bajtw na migawk)
+#define STREAM_SUBSCRIBERS_MAX  1
+#define STREAM_HISTORY          2
+
+// planista zada ptli gwnej (tyle, ile zada w tablicy tasks[] w telemetry.c) - 6 bajtw RAM na zadanie (z PERF 18)
+#define SCHED_TASKS_MAX         9
+
+// pomiary czasw wykonania i opnie obsugi przerwa i zada (polecenie RS 'l', /json/perf) - 22 bajty RAM
+// na obsug, bez PERF pomiary nie s kompilowane
+//#define PERF
+
 // ustawienie pinu uC do obslugi 1wire
 #define OW_PORT         PORTC
 #define OW_PIN          7
 
+// niezalene magistrale 1wire na pinach portu OW_PORT - transakcje na wszystkich naraz
+// (bufory transakcji: 21 bajtw RAM na magistral)
+#define OW_BUSES        1
+#define OW_BUS_PINS     {OW_PIN}
+
+// dziennik pomiarw na karcie SD (za sektorami systemu plikw FS)
+//
+#define JOURNAL_FIRST_SECTOR    128
+#define JOURNAL_SECTORS         4096    // 2 MB (obcinane do pocztku partycji FAT)
+#define JOURNAL_ERASE_AHEAD     16      // sektory kasowane z wyprzedzeniem
+#define JOURNAL_FRAME_SAMPLES   60      // maks. liczba prbek w ramce (tyle mona straci przy zaniku zasilania)
+
+// agregaty minutowe / godzinowe temperatur na karcie SD (za dziennikiem pomiarw)
+//
+#define TREND_FIRST_SECTOR      (JOURNAL_FIRST_SECTOR + JOURNAL_SECTORS)
+#define TREND_MINUTE_SECTORS    1260    // 7 dni (8 minut na sektor)
+#define TREND_HOUR_SECTORS      1095    // 365 dni (8 godzin na sektor)
+
+// indeks czasowy sektorw dziennika (za agregatami)
+//
+#define JOURNAL_INDEX_FIRST_SECTOR  (TREND_FIRST_SECTOR + TREND_MINUTE_SECTORS + TREND_HOUR_SECTORS)
+
 // piny dla przyciskw
 #define KEYS_S1_PORT PORTD
 #define KEYS_S1_BIT  6 // 4
@@ -87,9 +154,12 @@
 #define dec2hex(val)  ( (val) < 10 ? '0' + (val) : 'A'-10 + (val) )
 
 // zmienne globalne
-volatile unsigned char pooling_step;  // krok poolingu
+volatile unsigned long pooling_ticks; // liczba taktw poolingu (25 ms) od startu
 volatile unsigned long uptime;        // uptime systemu w sekundach
 
+// czas od startu w us (takty poolingu + licznik Timer1) - przy zablokowanych przerwaniach
+unsigned long pooling_time_us();
+
 // konfiguracja I/O wybranego uC
 #include <avr/io.h>
 
@@ -108,6 +178,9 @@ volatile unsigned long uptime;        // uptime systemu w sekundach
 // watchdog
 #include <avr/wdt.h>
 
+// sumy kontrolne CRC16 (dziennik pomiarw)
+#include <util/crc16.h>
+
 // reset AVR'a
 #define soft_reset()        \
 do                          \
@@ -165,6 +238,10 @@ typedef struct
 #include "lib/eeprom.h" // pamieci EEPROM (zgodne z AT25*)
 #include "lib/sd.h"     // karta SD/MMC
 #include "lib/fs.h"     // FS: bardzo prosty system plikw
+#include "lib/fat.h"    // FAT16: zapis plikw CSV czytelnych na PC
+#include "lib/journal.h" // dziennik pomiarw (zapis sekwencyjny, odporny na zaniki zasilania)
+#include "lib/trend.h"   // agregaty minutowe / godzinowe temperatur
+#include "lib/adc.h"     // akwizycja z przetwornika ADC (przerwania, bufor podwjny)
 #include "lib/enc28.h"  // kontroler Ethernetu ENC28J60
 
 // 1wire
@@ -176,15 +253,31 @@ typedef struct
 #include "lib/webpage.h"  // obsluga zadan HTTP
 #include "lib/firmware.h" // aktualizacja / pobieranie danych z firmware'u (pamiec EEPROM)
 #include "lib/daq.h"      // obsluga da DAQ na porcie UDP (MATLAB)
+#include "lib/stream.h"   // subskrypcje strumienia pomiarw wysyanego na port UDP klienta
 
 // sterownik PWM PID
-#include "lib/pwm.h"    // programowy, omiokanaowy sterownik PWM
-//#include "lib/pid.h"    // regulator PID
+#include "lib/pwm.h"    // omiokanaowy sterownik PWM (programowy / sprztowy na Timer2)
+#include "lib/pid.h"    // regulator PID
 
 // ustawienia systemu przechowywane w pamici EEPROM uC
 #include "lib/config.h"
 
-// przerwanie INT1
+// planista zada okresowych
+#include "lib/sched.h"
+#include "lib/perf.h"   // pomiary czasw obsugi przerwa i zada
+
+// zadania ptli gwnej (tablica w telemetry.c)
+#define TASK_ADC        0
+#define TASK_NET        1
+#define TASK_RS         2
+#define TASK_KEYS       3
+#define TASK_LCD        4
+#define TASK_DAQ        5
+#define TASK_TREND      6
+#define TASK_NTP        7
+#define TASK_CONFIG     8
+
+// odbir pakietu z ENC28 (zadanie TASK_NET zgaszane przerwaniem INT1)
 void on_int1();
 
 // komenda RS
@@ -203,10 +296,10 @@ extern const char PROGRAM_VERSION1[] PROGMEM;
 extern const char PROGRAM_VERSION2[] PROGMEM;
 
 // regulatory PID
-//pid_regulator pid[PID_COUNT];
+pid_regulator pid[PID_COUNT];
 
 // partycja FAT
-//fat_partition fat;
+fat_partition fat;
 
 
 #endif